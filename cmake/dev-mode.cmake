@@ -39,13 +39,26 @@ target_sources_grouped(
     gif_engine_gif_engine TREE "${PROJECT_SOURCE_DIR}" FILES
     include/gif_engine/error.h
     include/gif_engine/gif_engine.h
+    include/gif_engine/gif_engine.hpp
     include/gif_engine/structs.h
     source/binary_literal.h
     source/buffer_ops.h
+    source/hash.h
     source/try.h
+    source/work.h
+    source/context/context.h
+    source/decode/analytics.h
+    source/decode/compose.h
     source/decode/decode.h
+    source/decode/lzw.h
+    source/frame_table/frame_table.h
+    source/index/index.h
     source/parse/parse.h
     source/parse/parse_state.h
+    source/parse/scan.h
+    source/simd/simd.h
+    source/spill/spill.h
+    source/timeline/timeline.h
 )
 
 source_group(
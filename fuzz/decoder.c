@@ -0,0 +1,315 @@
+#include <gif_engine/gif_engine.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "work.h"
+
+/* Every frame takes more than a dozen bytes of input and writes each canvas
+ * pixel a few times at most, while each byte of image data holds less than 3
+ * LZW codes, so linear work is well below this many units per input byte and
+ * canvas pixel */
+#define WORK_PER_UNIT 16U
+
+/* Canvases are 4 bytes per pixel and the frame vector grows geometrically */
+#define ALLOCATION_PER_UNIT (WORK_PER_UNIT * 4U)
+
+/* Covers allocations that do not depend on the input, like lookup tables */
+#define ALLOCATION_SLACK (1024U * 1024U)
+
+/* Large outputs only make the fuzzer slow, the bound is what matters */
+#define MAX_DECODED_BYTES (64U * 1024U * 1024U)
+
+#define TILE_SIZE 16U
+
+static uint64_t allocated_bytes;
+
+static void* counting_realloc(void* allocation, size_t size)
+{
+  allocated_bytes += size;
+  return realloc(allocation, size);
+}
+
+/**
+ * Runs the tasks one after another on the calling thread. Two workers are
+ * reported so the pipelined and banded paths are taken, which is fine,
+ * because no task ever waits for another one.
+ */
+static void serial_run(void* executor_context,
+                       gif_task task,
+                       void* task_context,
+                       size_t count)
+{
+  (void)executor_context;
+  for (size_t i = 0; i < count; ++i) {
+    task(task_context, i);
+  }
+}
+
+static const gif_executor serial_executor = {&serial_run, NULL, 2};
+
+typedef struct memory_file {
+  const uint8_t* data;
+  size_t size;
+} memory_file;
+
+static bool read_memory(void* context,
+                        uint64_t offset,
+                        void* buffer,
+                        size_t size)
+{
+  const memory_file* file = context;
+  if (offset > file->size || size > file->size - offset) {
+    return false;
+  }
+
+  memcpy(buffer, &file->data[offset], size);
+  return true;
+}
+
+static void ignore_frame(void* context,
+                         size_t frame_index,
+                         const uint8_t* canvas)
+{
+  (void)context;
+  (void)frame_index;
+  (void)canvas;
+}
+
+static void check_cost(const char* path,
+                       const char* name,
+                       uint64_t cost,
+                       uint64_t bound)
+{
+  if (cost > bound) {
+    fprintf(stderr,
+            "%s: %s: %llu exceeds the bound of %llu\n",
+            path,
+            name,
+            (unsigned long long)cost,
+            (unsigned long long)bound);
+    abort();
+  }
+}
+
+/** Resets the costs before running a single entry point. */
+static void begin_path(void)
+{
+  allocated_bytes = 0;
+  gif_work_take();
+}
+
+/** Checks the costs of the entry point run since ::begin_path. */
+static void end_path(const char* path, uint64_t units)
+{
+  gif_work_counters work = gif_work_take();
+  check_cost(path, "LZW codes", work.lzw_codes, units * WORK_PER_UNIT);
+  check_cost(
+      path, "Pixels written", work.pixels_written, units * WORK_PER_UNIT);
+  check_cost(path,
+             "Allocated bytes",
+             allocated_bytes,
+             units * ALLOCATION_PER_UNIT + ALLOCATION_SLACK);
+}
+
+static uint64_t cost_units(const gif_details* details, size_t size)
+{
+  const gif_descriptor* descriptor = &details->descriptor;
+  uint64_t canvas_pixels =
+      (uint64_t)descriptor->canvas_width * descriptor->canvas_height;
+  return (uint64_t)size * (canvas_pixels != 0 ? canvas_pixels : 1U);
+}
+
+static uint64_t canvas_bytes(const gif_details* details)
+{
+  const gif_descriptor* descriptor = &details->descriptor;
+  return (uint64_t)descriptor->canvas_width * descriptor->canvas_height * 4U;
+}
+
+/**
+ * Whether the output of decoding all frames stays below the decoded size
+ * limit. Otherwise the buffers passed in would be too large to allocate.
+ */
+static bool fits_decoded_limit(const gif_details* details)
+{
+  uint64_t bytes = canvas_bytes(details);
+  return bytes != 0 && details->frame_vector.size <= MAX_DECODED_BYTES / bytes;
+}
+
+static void fuzz_stores(const gif_details* details, uint64_t units)
+{
+  if (fits_decoded_limit(details)) {
+    uint8_t* dirty_tiles = malloc(gif_dirty_tiles_size(details, TILE_SIZE));
+    gif_decode_options tiled_options = {
+        .tile_size = TILE_SIZE,
+        .dirty_tiles = dirty_tiles,
+    };
+    begin_path();
+    gif_frame_store store;
+    gif_decode_to_store(details, &counting_realloc, &tiled_options, &store);
+    gif_frame_store_free(&store, &free);
+    end_path("gif_decode_to_store tiled", units);
+    free(dirty_tiles);
+  }
+
+  gif_decode_options pipelined_options = {
+      .executor = &serial_executor,
+      .frame_ready = &ignore_frame,
+  };
+  begin_path();
+  gif_frame_store store;
+  gif_decode_to_store(details, &counting_realloc, &pipelined_options, &store);
+  gif_frame_store_free(&store, &free);
+  end_path("gif_decode_to_store pipelined", units);
+}
+
+static void fuzz_frames(const gif_details* details, uint64_t units)
+{
+  if (!fits_decoded_limit(details)) {
+    return;
+  }
+
+  const gif_descriptor* descriptor = &details->descriptor;
+  uint8_t* pixels = calloc(1, (size_t)canvas_bytes(details));
+  if (pixels == NULL) {
+    return;
+  }
+
+  gif_decode_target target = {
+      .pixels = pixels,
+      .stride = (size_t)descriptor->canvas_width * 4U,
+      .format = GIF_PIXEL_FORMAT_RGBA8888,
+      .region = GIF_TARGET_CANVAS,
+  };
+  size_t frame_count = details->frame_vector.size;
+
+  begin_path();
+  for (size_t i = 0; i < frame_count; ++i) {
+    gif_decode_frame(details, i, &target);
+  }
+  end_path("gif_decode_frame", units);
+
+  begin_path();
+  for (size_t i = 0; i < frame_count; ++i) {
+    gif_decode_frame_parallel(
+        details, i, &target, &serial_executor, &counting_realloc, &free);
+  }
+  end_path("gif_decode_frame_parallel", units);
+
+  free(pixels);
+}
+
+static void fuzz_details(gif_details* details, uint64_t units)
+{
+  begin_path();
+  gif_decode_result decode_result = gif_decode(details, &counting_realloc);
+  free(decode_result.data);
+  end_path("gif_decode", units);
+
+  fuzz_stores(details, units);
+
+  begin_path();
+  gif_indexed_frames frames;
+  gif_decode_indexed(details, &counting_realloc, &frames);
+  gif_indexed_frames_free(&frames, &free);
+  end_path("gif_decode_indexed", units);
+
+  fuzz_frames(details, units);
+
+  gif_frame_verify_result* results =
+      malloc(details->frame_vector.size * sizeof(gif_frame_verify_result));
+  if (results != NULL) {
+    begin_path();
+    gif_verify(details, results);
+    end_path("gif_verify", units);
+    free(results);
+  }
+
+  begin_path();
+  gif_timeline timeline;
+  if (gif_timeline_build(details, &timeline, &counting_realloc)
+      == GIF_SUCCESS)
+  {
+    gif_timeline_frame_at(&timeline, timeline.duration / 2U);
+    gif_timeline_free(&timeline, &free);
+  }
+  end_path("gif_timeline_build", units);
+}
+
+static void fuzz_source(const uint8_t* data, size_t size)
+{
+  memory_file file = {data, size};
+  gif_source source = {&read_memory, &file, size};
+  gif_parse_options options = {
+      .limits = {.max_total_decoded_bytes = MAX_DECODED_BYTES},
+  };
+
+  begin_path();
+  gif_details details;
+  gif_parse_result parse_result =
+      gif_parse_source(&source, &details, &counting_realloc, &options);
+  uint64_t units = cost_units(&details, size);
+  end_path("gif_parse_source", units);
+
+  if (parse_result.code == GIF_SUCCESS) {
+    begin_path();
+    gif_decode_result decode_result = gif_decode(&details, &counting_realloc);
+    free(decode_result.data);
+    end_path("gif_decode from a source", units);
+  }
+
+  gif_free_details(&details, &free);
+}
+
+static void fuzz_context(const uint8_t* data, size_t size)
+{
+  gif_context context;
+  gif_context_init(&context, &counting_realloc, &free);
+  gif_parse_options options = {
+      .limits = {.max_total_decoded_bytes = MAX_DECODED_BYTES},
+  };
+
+  begin_path();
+  gif_parse_result parse_result =
+      gif_context_parse(&context, data, size, &options);
+  uint64_t units = cost_units(&context.details, size);
+  if (parse_result.code == GIF_SUCCESS) {
+    gif_context_decode(&context);
+  }
+  end_path("gif_context_parse and gif_context_decode", units);
+
+  gif_context_free(&context);
+}
+
+int LLVMFuzzerTestOneInput(uint8_t* data, size_t size)
+{
+  if (size == 0) {
+    return 0;
+  }
+
+  /* Files of a megabyte or more are scanned in parallel */
+  gif_parse_options options = {
+      .limits = {.max_total_decoded_bytes = MAX_DECODED_BYTES},
+      .executor = &serial_executor,
+      .deallocator = &free,
+  };
+
+  begin_path();
+  gif_details details;
+  gif_parse_result parse_result = gif_parse_with_options(
+      data, size, &details, &counting_realloc, &options);
+  uint64_t units = cost_units(&details, size);
+  end_path("gif_parse_with_options", units);
+
+  if (parse_result.code == GIF_SUCCESS) {
+    fuzz_details(&details, units);
+  }
+  gif_free_details(&details, &free);
+
+  fuzz_source(data, size);
+  fuzz_context(data, size);
+  return 0;
+}
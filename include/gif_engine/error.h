@@ -1,6 +1,7 @@
 #pragma once
 
 #include <gif_engine/result_code.h>
+#include <stddef.h>
 
 typedef struct gif_parse_result {
   gif_result_code code;
@@ -10,5 +11,10 @@ typedef struct gif_parse_result {
 
 typedef struct gif_decode_result {
   gif_result_code code;
-  const void* data;
+  void* data;
 } gif_decode_result;
+
+typedef struct gif_frame_verify_result {
+  gif_result_code code;
+  size_t pixel_count;
+} gif_frame_verify_result;
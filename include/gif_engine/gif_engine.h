@@ -15,6 +15,32 @@ typedef void* (*gif_allocator)(void* pointer, size_t size);
 /** A deallocator function type matching that of \c free. */
 typedef void (*gif_deallocator)(void* allocation);
 
+/** A unit of work run by a gif_executor for each index up to its count. */
+typedef void (*gif_task)(void* context, size_t index);
+
+/**
+ * Calls \c task with \c task_context and every index in <tt>[0, count)</tt>,
+ * possibly in parallel, and returns once all calls finished.
+ */
+typedef void (*gif_executor_run)(void* executor_context,
+                                 gif_task task,
+                                 void* task_context,
+                                 size_t count);
+
+/**
+ * A thread pool provided by the user. The library never creates threads on its
+ * own, it hands work to the \c run function of an executor instead.
+ */
+typedef struct gif_executor {
+  gif_executor_run run;
+
+  /** Passed to \c run as is. */
+  void* context;
+
+  /** Number of tasks \c run can make progress on at the same time. */
+  size_t worker_count;
+} gif_executor;
+
 /**
  * Parses the GIF file located at \c buffer. This function will parse the
  * contents of \c buffer in a way that makes OOB reads impossible, if the
@@ -54,12 +80,536 @@ GIF_ENGINE_EXPORT gif_parse_result gif_parse(const void* buffer,
                                              gif_allocator allocator);
 
 /**
- * Decodes the frame data parsed by ::gif_parse. This function is not yet
- * implemented.
+ * Optional settings for ::gif_parse_with_options.
+ */
+typedef struct gif_parse_options {
+  /**
+   * Resource limits for the file. These are stored in the \c limits member of
+   * the gif_details struct, so they are honored by ::gif_decode as well.
+   */
+  gif_limits limits;
+
+  /**
+   * If not 0, parsing stops right after the data of this many frames, so
+   * nothing past them is read or allocated and only they get decoded. For
+   * link previews, 1 gets the poster frame of an animation in time and memory
+   * proportional to that frame alone. The \c is_partial member of gif_details
+   * is set if the trailer of the file was not reached because of this.
+   */
+  size_t stop_after_frames;
+
+  /**
+   * Application extensions other than the NETSCAPE2.0 looping extension, like
+   * XMP metadata, ICC profiles or ANIMEXTS1.0, are skipped over by default.
+   * If this is \c true, then they are listed in the \c application_extensions
+   * member of gif_details as spans of the file instead.
+   */
+  bool keep_application_extensions;
+
+  /**
+   * If not \c NULL and it has more than one worker, then files of a megabyte
+   * or more are scanned for their block structure on this executor, and the
+   * image data of their frames is hashed on it as well. Every worker guesses
+   * where the blocks in its part of the file are, and a sequential pass only
+   * has to walk until it meets a guess. The result is the same as that of a
+   * sequential parse in every case, except that the scratch memory of the
+   * scan counts towards \c max_memory of the limits. Ignored for partial
+   * parses and by ::gif_parse_source, which read the file front to back.
+   */
+  const gif_executor* executor;
+
+  /**
+   * Takes back the scratch memory of the parallel scan, which is allocated
+   * with the \c allocator of the parse. \c executor is ignored without it.
+   */
+  gif_deallocator deallocator;
+} gif_parse_options;
+
+/**
+ * Same as ::gif_parse, but with the settings in \c options applied. Passing
+ * \c NULL for \c options is equivalent to calling ::gif_parse.
+ *
+ * Limits are checked as soon as the information needed to check them has been
+ * read, so e.g. a logical screen descriptor declaring a canvas larger than
+ * allowed fails the parse before anything is allocated.
+ *
+ * This function is thread-safe.
+ */
+GIF_ENGINE_EXPORT gif_parse_result
+gif_parse_with_options(const void* buffer,
+                       size_t buffer_size,
+                       gif_details* details,
+                       gif_allocator allocator,
+                       const gif_parse_options* options);
+
+/**
+ * Same as ::gif_parse_with_options, but the file is read from \c source
+ * through a small window on the stack instead of having to be in memory as a
+ * whole. The parser records the offset of the image data of each frame in
+ * its \c data_offset member, and decoding reads the data from \c source
+ * again through a small readahead buffer, so files larger than the address
+ * space can be processed. \c source must outlive \c details.
+ *
+ * The \c last_position member of the returned gif_parse_result object is
+ * always \c NULL. If \c source fails to read, then the \c code member is
+ * ::GIF_SOURCE_READ_FAIL.
+ *
+ * This function is thread-safe.
+ */
+GIF_ENGINE_EXPORT gif_parse_result
+gif_parse_source(const gif_source* source,
+                 gif_details* details,
+                 gif_allocator allocator,
+                 const gif_parse_options* options);
+
+/**
+ * Decodes and composes every frame parsed by ::gif_parse. Composition starts
+ * from a fully transparent canvas and honors the disposal method of each
+ * frame. Frames that would redraw exactly what the frame before them left on
+ * the canvas are not decoded at all, their canvas is copied instead.
+ *
+ * If the \c code member of the returned gif_decode_result object is
+ * ::GIF_SUCCESS, then the \c data member points to
+ * <tt>details-&gt;frame_vector.size</tt> consecutive canvases, each
+ * <tt>canvas_width * canvas_height</tt> pixels in the
+ * ::GIF_PIXEL_FORMAT_RGBA8888 format without any row padding.
+ *
+ * The \c data member must be freed using the deallocator matching \c allocator
+ * whenever it is not \c NULL, even if decoding did not succeed.
+ *
+ * The limits stored in \c details by ::gif_parse_with_options apply to the
+ * memory allocated by this function as well.
+ *
+ * This function is thread-safe.
  */
 GIF_ENGINE_EXPORT gif_decode_result gif_decode(gif_details* details,
                                                gif_allocator allocator);
 
+/**
+ * Called with the index of each canvas as soon as it is fully composed.
+ */
+typedef void (*gif_frame_ready_function)(void* context,
+                                         size_t frame_index,
+                                         const uint8_t* canvas);
+
+/**
+ * Optional settings for ::gif_decode_to_store.
+ */
+typedef struct gif_decode_options {
+  /**
+   * If the decoded output would take more than this many bytes, then it is
+   * written to a memory mapped temporary file instead of memory from the
+   * allocator. A value of 0 means the output is never spilled.
+   */
+  size_t spill_threshold;
+
+  /**
+   * Directory to create the temporary file in. \c NULL selects the default
+   * temporary directory of the OS.
+   */
+  const char* spill_directory;
+
+  /**
+   * If not \c NULL and it has at least 2 workers, then decoding is split into
+   * two stages: the LZW stream of the next frame is decoded into an index
+   * buffer while the current frame is composed onto its canvas. A frame then
+   * takes about as long as the slower of the two stages instead of their
+   * sum. This needs two index buffers the size of the largest frame on top of
+   * the output.
+   */
+  const gif_executor* executor;
+
+  /**
+   * If not \c NULL, then this function is called for each canvas in order as
+   * soon as it is done, which lets playback start before the whole file is
+   * decoded. With an \c executor it is called from one of its workers.
+   */
+  gif_frame_ready_function frame_ready;
+  void* frame_ready_context;
+
+  /**
+   * If not \c NULL, then this must point to <tt>details->frame_vector.size</tt>
+   * structs, which are filled with the statistics of each frame while it is
+   * composed. The statistics are kept over the 256 palette indices instead of
+   * the composed pixels, so no extra pass over the canvases is made.
+   */
+  gif_frame_analytics* analytics;
+
+  /**
+   * If not 0, then the canvases are laid out in tiles as described for the
+   * \c tile_size member of gif_decode_target, which changes the
+   * \c canvas_size member of the store accordingly. Padding pixels of the
+   * edge tiles are left fully transparent.
+   */
+  uint16_t tile_size;
+
+  /**
+   * If not \c NULL and \c tile_size is not 0, then this must point to
+   * ::gif_dirty_tiles_size bytes, which are filled with a bitmap per frame of
+   * the tiles whose pixels may differ from the canvas before, or from a fully
+   * transparent canvas for the first frame. Tile \c t of frame \c i is bit
+   * <tt>t % 8</tt> of byte <tt>i * bitmap_size + t / 8</tt>, where tiles are
+   * numbered in the order they are laid out and \c bitmap_size is the size
+   * divided by the number of frames. The bitmap of a frame is ready when its
+   * \c frame_ready call is made.
+   */
+  uint8_t* dirty_tiles;
+} gif_decode_options;
+
+/**
+ * Returns the size in bytes of the dirty tile bitmaps of all frames in
+ * \c details for the given \c tile_size, which must not be 0.
+ */
+GIF_ENGINE_EXPORT size_t gif_dirty_tiles_size(const gif_details* details,
+                                              uint16_t tile_size);
+
+/**
+ * Same as ::gif_decode, but the canvases are placed in \c store, which may be
+ * backed by a memory mapped temporary file according to \c options. Passing
+ * \c NULL for \c options always decodes into memory from \c allocator.
+ *
+ * A spilled store keeps the resident memory of the process bounded: each
+ * canvas is handed back to the OS as soon as decoding no longer needs it and
+ * is paged back in from the file when accessed. The file is removed
+ * automatically and ::GIF_SPILL_FAIL is returned if it cannot be created. The
+ * \c max_memory limit does not apply to spilled output, while
+ * \c max_total_decoded_bytes still does.
+ *
+ * \c store must be freed using ::gif_frame_store_free, even if decoding did
+ * not succeed.
+ *
+ * This function is thread-safe.
+ */
+GIF_ENGINE_EXPORT gif_result_code
+gif_decode_to_store(const gif_details* details,
+                    gif_allocator allocator,
+                    const gif_decode_options* options,
+                    gif_frame_store* store);
+
+/**
+ * Frees the gif_frame_store struct populated by ::gif_decode_to_store. The
+ * \c deallocator is only used if the store was not spilled.
+ */
+GIF_ENGINE_EXPORT void gif_frame_store_free(const gif_frame_store* store,
+                                            gif_deallocator deallocator);
+
+/**
+ * Same as ::gif_decode, but the canvases are kept as palette indices against
+ * a single palette, which takes a quarter of the memory. Colors are only
+ * produced when a canvas is expanded with ::gif_indexed_frame_expand.
+ *
+ * This works if every frame is drawn with the same colors, which is the case
+ * when there are no local color tables or they all match, and if some index
+ * is never drawn as an opaque pixel, so it can stand for the transparent
+ * pixels of the canvas. This is the transparent index of the first frame that
+ * has one, otherwise the first index past the color table, or the last index
+ * if the color table is full. If either
+ * condition does not hold, then ::GIF_INDEXED_UNSUPPORTED is returned, and
+ * the caller can fall back to ::gif_decode. The first condition is checked
+ * before anything is decoded, the second one while decoding.
+ *
+ * \c frames must be freed using ::gif_indexed_frames_free, even if decoding
+ * did not succeed.
+ *
+ * This function is thread-safe.
+ */
+GIF_ENGINE_EXPORT gif_result_code
+gif_decode_indexed(const gif_details* details,
+                   gif_allocator allocator,
+                   gif_indexed_frames* frames);
+
+/**
+ * Writes the colors of canvas \c index of \c frames to \c target, which must
+ * cover the logical screen and be laid out in rows.
+ *
+ * This function does not allocate and is thread-safe.
+ */
+GIF_ENGINE_EXPORT gif_result_code
+gif_indexed_frame_expand(const gif_indexed_frames* frames,
+                         size_t index,
+                         const gif_decode_target* target);
+
+/**
+ * Frees the gif_indexed_frames struct populated by ::gif_decode_indexed.
+ */
+GIF_ENGINE_EXPORT void gif_indexed_frames_free(const gif_indexed_frames* frames,
+                                               gif_deallocator deallocator);
+
+/**
+ * Decodes the frame at \c frame_index directly into caller owned memory,
+ * without any intermediate allocation. The \c target argument describes the
+ * memory: its \c stride may include any amount of row padding, it may be laid
+ * out in tiles instead of rows, and its \c region selects whether it covers
+ * the whole logical screen or just the frame. When drawing onto a canvas,
+ * disposing of the previous frame before calling this function is up to the
+ * caller.
+ *
+ * The frame is decoded a row at a time and written straight to \c target, so
+ * if decoding fails midway, then the rows before the failure will have been
+ * written already.
+ *
+ * This function does not allocate and is thread-safe.
+ */
+GIF_ENGINE_EXPORT gif_result_code
+gif_decode_frame(const gif_details* details,
+                 size_t frame_index,
+                 const gif_decode_target* target);
+
+/**
+ * Same as ::gif_decode_frame, but palette expansion and composition run on
+ * the workers of \c executor. The frame is split into horizontal bands: while
+ * one task decodes the LZW stream of the next band, the rest of the workers
+ * compose the current one, each writing a disjoint set of rows. This pays off
+ * for frames of millions of pixels, where composition would otherwise take as
+ * long as decoding the LZW stream on a single core.
+ *
+ * The indices of two bands are buffered in memory from \c allocator, which is
+ * freed using \c deallocator before returning. If \c executor is \c NULL or
+ * has fewer than 2 workers, then this function behaves exactly like
+ * ::gif_decode_frame and allocates nothing.
+ *
+ * This function is thread-safe.
+ */
+GIF_ENGINE_EXPORT gif_result_code
+gif_decode_frame_parallel(const gif_details* details,
+                          size_t frame_index,
+                          const gif_decode_target* target,
+                          const gif_executor* executor,
+                          gif_allocator allocator,
+                          gif_deallocator deallocator);
+
+/**
+ * Checks the image data of every frame parsed by ::gif_parse without decoding
+ * it. The LZW stream of each frame is run through the decompressor's state
+ * machine, but no pixels are written and no canvas is allocated, which makes
+ * this function much cheaper than ::gif_decode. This is useful for rejecting
+ * malformed files early.
+ *
+ * The \c results argument must point to an array of at least
+ * <tt>details-&gt;frame_vector.size</tt> elements. Each element receives the
+ * status of the corresponding frame and the number of pixels its stream
+ * decodes to. A frame is valid if its stream contains only valid codes and
+ * decodes to exactly <tt>width * height</tt> pixels.
+ *
+ * @return ::GIF_SUCCESS if every frame is valid, otherwise the code of the
+ * first invalid frame
+ *
+ * This function does not allocate and is thread-safe.
+ */
+GIF_ENGINE_EXPORT gif_result_code gif_verify(const gif_details* details,
+                                             gif_frame_verify_result* results);
+
+/**
+ * Returns the number of bytes ::gif_index_write needs to serialize
+ * \c details.
+ */
+GIF_ENGINE_EXPORT size_t gif_index_size(const gif_details* details);
+
+/**
+ * Serializes the gif_details struct populated by ::gif_parse into a compact,
+ * versioned binary index, which ::gif_index_load can turn back into a
+ * gif_details struct without parsing the GIF file again. The index stores
+ * offsets relative to the start of the file instead of pointers, so it stays
+ * valid for any copy or mapping of the same file.
+ *
+ * The \c index argument must point to at least
+ * <tt>gif_index_size(details)</tt> bytes, otherwise
+ * ::GIF_INDEX_BUFFER_TOO_SMALL is returned.
+ *
+ * This function does not allocate and is thread-safe.
+ */
+GIF_ENGINE_EXPORT gif_result_code gif_index_write(const gif_details* details,
+                                                  void* index,
+                                                  size_t index_size);
+
+/**
+ * Populates \c details from an index written by ::gif_index_write for the GIF
+ * file located at \c buffer, as if ::gif_parse had been called on it. Only the
+ * color tables are read from the file and the length bytes of the sub-blocks
+ * are walked to make sure the frames stay within \c buffer, everything else
+ * comes straight from the index.
+ *
+ * The index is treated as untrusted input: a malformed index fails with
+ * ::GIF_INDEX_INVALID, an index from another version of this library with
+ * ::GIF_INDEX_VERSION_MISMATCH and an index that does not fit \c buffer with
+ * ::GIF_INDEX_DATA_MISMATCH. The index is only checked against the size of
+ * the file, so pairing it with the right file is up to the caller.
+ *
+ * The fingerprints of the frames are taken from the index as they are, so
+ * they are only as trustworthy as the index. Decoding never relies on them
+ * alone, a stale or tampered index can not make a frame show the pixels of
+ * another one.
+ *
+ * Like with ::gif_parse, \c details need not be zero initialized and must be
+ * freed using ::gif_free_details, even if this function did not succeed. The
+ * limits of \c details are left zeroed.
+ *
+ * This function is thread-safe.
+ */
+GIF_ENGINE_EXPORT gif_result_code gif_index_load(const void* index,
+                                                 size_t index_size,
+                                                 const void* buffer,
+                                                 size_t buffer_size,
+                                                 gif_details* details,
+                                                 gif_allocator allocator);
+
+/**
+ * Builds a structure of arrays table of the frames in \c details. All the
+ * arrays are placed in a single allocation made using \c allocator, which
+ * must be freed using ::gif_frame_table_free. Color tables are borrowed from
+ * \c details, so the table must not outlive it.
+ *
+ * Data offsets are 32 bit, so files larger than 4 GiB fail with
+ * ::GIF_FRAME_TABLE_OFFSET_OVERFLOW.
+ *
+ * This function is thread-safe.
+ */
+GIF_ENGINE_EXPORT gif_result_code
+gif_frame_table_build(const gif_details* details,
+                      gif_frame_table* table,
+                      gif_allocator allocator);
+
+/**
+ * Frees the gif_frame_table struct populated by ::gif_frame_table_build. This
+ * function should be called even if ::gif_frame_table_build did not succeed.
+ */
+GIF_ENGINE_EXPORT void gif_frame_table_free(const gif_frame_table* table,
+                                            gif_deallocator deallocator);
+
+/**
+ * Builds a table of the cumulative delays of the frames in \c details, which
+ * makes ::gif_timeline_frame_at a binary search instead of a scan over all
+ * frames. Delays below 2 hundredths of a second, including unset delays, are
+ * replaced with 10 hundredths of a second, matching what browsers do. The
+ * table is allocated using \c allocator and must be freed using
+ * ::gif_timeline_free if this function succeeded.
+ *
+ * A \c repeat_count of 0 is taken to mean that the animation loops forever,
+ * as the NETSCAPE2.0 extension defines. Files without that extension are
+ * played once, like browsers do.
+ *
+ * This function is thread-safe.
+ */
+GIF_ENGINE_EXPORT gif_result_code gif_timeline_build(const gif_details* details,
+                                                     gif_timeline* timeline,
+                                                     gif_allocator allocator);
+
+/**
+ * Returns the index of the frame visible \c time milliseconds after the
+ * animation started playing, in O(log n) time. Once every repetition of the
+ * animation has been played, the last frame stays visible.
+ *
+ * This function does not allocate and is thread-safe.
+ */
+GIF_ENGINE_EXPORT size_t gif_timeline_frame_at(const gif_timeline* timeline,
+                                               uint64_t time);
+
+/**
+ * Frees the gif_timeline struct populated by ::gif_timeline_build.
+ */
+GIF_ENGINE_EXPORT void gif_timeline_free(const gif_timeline* timeline,
+                                         gif_deallocator deallocator);
+
+/**
+ * Long-lived parsing and decoding state for processing many files in a row.
+ * The frame vector, a pool for color tables and the buffer for the decoded
+ * canvases are kept between files, so once they have grown to fit the files
+ * seen so far, parsing and decoding make no heap allocations at all. The LZW
+ * tables never need the heap, because they live on the stack.
+ *
+ * The members are managed by the gif_context_* functions. \c details holds
+ * the file parsed last and may be read, but must not be passed to
+ * ::gif_free_details.
+ */
+typedef struct gif_context {
+  gif_details details;
+
+  gif_allocator allocator;
+  gif_deallocator deallocator;
+
+  uint32_t* color_pool;
+  size_t color_pool_capacity;
+  size_t color_pool_used;
+
+  /**
+   * Number of colors that did not fit the pool while parsing the current
+   * file. These were allocated separately, and the pool grows to fit them
+   * when the next file is parsed.
+   */
+  size_t color_pool_overflow;
+
+  uint8_t* canvases;
+  size_t canvases_capacity;
+} gif_context;
+
+/**
+ * Prepares \c context for use. This function does not allocate.
+ */
+GIF_ENGINE_EXPORT void gif_context_init(gif_context* context,
+                                        gif_allocator allocator,
+                                        gif_deallocator deallocator);
+
+/**
+ * Same as ::gif_parse_with_options, but the details are parsed into the \c
+ * details member of \c context, replacing the file parsed before in O(1)
+ * time. Memory kept from previous files is reused.
+ *
+ * This function is not thread-safe for the same \c context.
+ */
+GIF_ENGINE_EXPORT gif_parse_result
+gif_context_parse(gif_context* context,
+                  const void* buffer,
+                  size_t buffer_size,
+                  const gif_parse_options* options);
+
+/**
+ * Same as ::gif_decode for the file parsed last into \c context, but the
+ * canvases are owned by \c context. They stay valid until the next call to
+ * this function, ::gif_context_trim or ::gif_context_free.
+ *
+ * This function is not thread-safe for the same \c context.
+ */
+GIF_ENGINE_EXPORT gif_decode_result gif_context_decode(gif_context* context);
+
+/**
+ * Frees the memory kept by \c context and discards the file parsed last. The
+ * context can still be used afterwards.
+ */
+GIF_ENGINE_EXPORT void gif_context_trim(gif_context* context);
+
+/**
+ * Frees the memory kept by \c context.
+ */
+GIF_ENGINE_EXPORT void gif_context_free(gif_context* context);
+
+/**
+ * Returns the highest ::gif_simd_level the CPU and OS support. The CPU is
+ * inspected the first time any kernel or this function is used, and the
+ * result is reused afterwards.
+ *
+ * This function is thread-safe.
+ */
+GIF_ENGINE_EXPORT gif_simd_level gif_simd_level_supported(void);
+
+/**
+ * Returns the ::gif_simd_level the kernels are dispatched for, which is the
+ * supported one unless ::gif_simd_level_force was used.
+ *
+ * This function is thread-safe.
+ */
+GIF_ENGINE_EXPORT gif_simd_level gif_simd_level_active(void);
+
+/**
+ * Dispatches the kernels for \c level instead of the supported level, for
+ * example to test the scalar baseline on a machine with AVX2. Forcing the
+ * supported level restores the default. The change applies to every frame
+ * composed and color table read after this function returns.
+ *
+ * @return ::GIF_SIMD_LEVEL_UNSUPPORTED if \c level is above the supported
+ * level
+ */
+GIF_ENGINE_EXPORT gif_result_code gif_simd_level_force(gif_simd_level level);
+
 /**
  * Frees the gif_details struct populated by ::gif_parse. This function should
  * be called even if the ::gif_parse function did not succeed.
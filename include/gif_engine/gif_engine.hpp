@@ -0,0 +1,508 @@
+#pragma once
+
+#include <gif_engine/gif_engine.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+/**
+ * Header-only C++17 layer over the C API. Every owning type is move-only and
+ * frees what it owns in its destructor, and the allocations the engine makes
+ * on their behalf come from a \c std::pmr::memory_resource.
+ */
+namespace gif
+{
+/**
+ * Thrown for every ::gif_result_code other than ::GIF_SUCCESS.
+ */
+class error : public std::runtime_error
+{
+public:
+  explicit error(gif_result_code code)
+      : std::runtime_error(describe(code))
+      , code_(code)
+  {
+  }
+
+  gif_result_code code() const noexcept { return code_; }
+
+private:
+  static std::string describe(gif_result_code code)
+  {
+    const char* const name = gif_result_code_to_string(code);
+    return name != nullptr ? name : "unknown gif_result_code";
+  }
+
+  gif_result_code code_;
+};
+
+inline void check(gif_result_code code)
+{
+  if (code != GIF_SUCCESS) {
+    throw error(code);
+  }
+}
+
+/**
+ * Non-owning view over contiguous elements, for frames, color tables and
+ * canvases.
+ */
+template<typename T>
+class span
+{
+public:
+  constexpr span() noexcept = default;
+
+  constexpr span(T* data, std::size_t size) noexcept
+      : data_(data)
+      , size_(size)
+  {
+  }
+
+  constexpr T* data() const noexcept { return data_; }
+  constexpr std::size_t size() const noexcept { return size_; }
+  constexpr bool empty() const noexcept { return size_ == 0; }
+  constexpr T* begin() const noexcept { return data_; }
+  constexpr T* end() const noexcept { return data_ + size_; }
+  constexpr T& operator[](std::size_t index) const { return data_[index]; }
+
+private:
+  T* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+namespace detail
+{
+/**
+ * Prefix of every block handed to the engine. The engine only passes a
+ * pointer back, so the resource and size needed to release the block are
+ * stored in front of it.
+ */
+struct alignas(std::max_align_t) block_header {
+  std::pmr::memory_resource* resource;
+  std::size_t size;
+};
+
+inline block_header* header_of(void* pointer) noexcept
+{
+  return static_cast<block_header*>(pointer) - 1;
+}
+
+/**
+ * The resource new blocks are taken from. The engine allocators are plain
+ * function pointers, so the resource is passed to them through this variable
+ * for the duration of a call.
+ */
+inline std::pmr::memory_resource*& current_resource() noexcept
+{
+  thread_local std::pmr::memory_resource* resource = nullptr;
+  return resource;
+}
+
+class resource_scope
+{
+public:
+  explicit resource_scope(std::pmr::memory_resource* resource) noexcept
+      : previous_(std::exchange(current_resource(), resource))
+  {
+  }
+
+  resource_scope(const resource_scope&) = delete;
+  resource_scope& operator=(const resource_scope&) = delete;
+
+  ~resource_scope() { current_resource() = previous_; }
+
+private:
+  std::pmr::memory_resource* previous_;
+};
+
+inline void deallocate(void* pointer) noexcept
+{
+  if (pointer == nullptr) {
+    return;
+  }
+
+  block_header* const header = header_of(pointer);
+  header->resource->deallocate(header,
+                               sizeof(block_header) + header->size,
+                               alignof(block_header));
+}
+
+/**
+ * A ::gif_allocator with \c realloc semantics on top of the current resource.
+ * Blocks never shrink, which suits monotonic resources that could not reuse
+ * the freed tail anyway.
+ */
+inline void* reallocate(void* pointer, std::size_t size) noexcept
+{
+  std::size_t old_size = 0;
+  if (pointer != nullptr) {
+    old_size = header_of(pointer)->size;
+    if (size <= old_size) {
+      return pointer;
+    }
+  }
+
+  if (size > SIZE_MAX - sizeof(block_header)) {
+    return nullptr;
+  }
+
+  std::pmr::memory_resource* resource = current_resource();
+  if (resource == nullptr) {
+    resource = std::pmr::get_default_resource();
+  }
+
+  void* block = nullptr;
+  try {
+    block =
+        resource->allocate(sizeof(block_header) + size, alignof(block_header));
+  } catch (...) {
+    return nullptr;
+  }
+
+  block_header* const header = ::new (block) block_header {resource, size};
+  void* const data = header + 1;
+  if (pointer != nullptr) {
+    std::memcpy(data, pointer, old_size);
+    deallocate(pointer);
+  }
+
+  return data;
+}
+
+inline void* reallocate_function(void* pointer, std::size_t size)
+{
+  return reallocate(pointer, size);
+}
+
+inline void deallocate_function(void* pointer)
+{
+  deallocate(pointer);
+}
+}  // namespace detail
+
+/**
+ * Number of colors in a color table, given the size field of its descriptor.
+ */
+constexpr std::size_t color_count(std::uint8_t size) noexcept
+{
+  return std::size_t {2} << size;
+}
+
+/**
+ * Owns a gif_details struct populated by ::gif_parse.
+ */
+class details
+{
+public:
+  /**
+   * Parses \c buffer, which must outlive the returned object, because frame
+   * data points into it.
+   */
+  static details parse(
+      const void* buffer,
+      std::size_t size,
+      const gif_parse_options* options = nullptr,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+  {
+    const detail::resource_scope scope(resource);
+    details result;
+    const gif_parse_result parse_result =
+        gif_parse_with_options(buffer,
+                               size,
+                               &result.details_,
+                               &detail::reallocate_function,
+                               options);
+    check(parse_result.code);
+    return result;
+  }
+
+  /**
+   * Parses the file read from \c source, which must outlive the returned
+   * object, because decoding reads the frame data from it again.
+   */
+  static details parse(
+      const gif_source& source,
+      const gif_parse_options* options = nullptr,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+  {
+    const detail::resource_scope scope(resource);
+    details result;
+    const gif_parse_result parse_result = gif_parse_source(
+        &source, &result.details_, &detail::reallocate_function, options);
+    check(parse_result.code);
+    return result;
+  }
+
+  details(details&& other) noexcept
+      : details_(std::exchange(other.details_, gif_details {}))
+  {
+  }
+
+  details& operator=(details&& other) noexcept
+  {
+    if (this != &other) {
+      release();
+      details_ = std::exchange(other.details_, gif_details {});
+    }
+
+    return *this;
+  }
+
+  details(const details&) = delete;
+  details& operator=(const details&) = delete;
+
+  ~details() { release(); }
+
+  const gif_details& get() const noexcept { return details_; }
+  gif_details& get() noexcept { return details_; }
+
+  const gif_descriptor& descriptor() const noexcept
+  {
+    return details_.descriptor;
+  }
+
+  span<const gif_frame_data> frames() const noexcept
+  {
+    return {details_.frame_vector.frames, details_.frame_vector.size};
+  }
+
+  span<const std::uint32_t> global_color_table() const noexcept
+  {
+    if (!details_.descriptor.packed.global_color_table_flag) {
+      return {};
+    }
+
+    return {details_.global_color_table,
+            color_count(details_.descriptor.packed.size)};
+  }
+
+  static span<const std::uint32_t> local_color_table(
+      const gif_frame_data& frame) noexcept
+  {
+    if (!frame.descriptor.packed.local_color_table_flag) {
+      return {};
+    }
+
+    return {frame.local_color_table, color_count(frame.descriptor.packed.size)};
+  }
+
+private:
+  details() noexcept = default;
+
+  void release() noexcept
+  {
+    gif_free_details(&details_, &detail::deallocate_function);
+  }
+
+  gif_details details_ {};
+};
+
+/**
+ * Owns the canvases composed by ::gif_decode.
+ */
+class canvases
+{
+public:
+  static canvases decode(
+      details& source,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+  {
+    const detail::resource_scope scope(resource);
+    const gif_decode_result decode_result =
+        gif_decode(&source.get(), &detail::reallocate_function);
+
+    const gif_descriptor& descriptor = source.descriptor();
+    canvases result(static_cast<std::uint8_t*>(decode_result.data),
+                    std::size_t {descriptor.canvas_width}
+                        * descriptor.canvas_height * 4U,
+                    source.frames().size());
+    check(decode_result.code);
+    return result;
+  }
+
+  canvases(canvases&& other) noexcept
+      : data_(std::exchange(other.data_, nullptr))
+      , canvas_size_(std::exchange(other.canvas_size_, 0))
+      , size_(std::exchange(other.size_, 0))
+  {
+  }
+
+  canvases& operator=(canvases&& other) noexcept
+  {
+    if (this != &other) {
+      detail::deallocate(data_);
+      data_ = std::exchange(other.data_, nullptr);
+      canvas_size_ = std::exchange(other.canvas_size_, 0);
+      size_ = std::exchange(other.size_, 0);
+    }
+
+    return *this;
+  }
+
+  canvases(const canvases&) = delete;
+  canvases& operator=(const canvases&) = delete;
+
+  ~canvases() { detail::deallocate(data_); }
+
+  /** Number of canvases, one per frame. */
+  std::size_t size() const noexcept { return size_; }
+
+  /** Size of a single canvas in bytes. */
+  std::size_t canvas_size() const noexcept { return canvas_size_; }
+
+  span<const std::uint8_t> operator[](std::size_t index) const noexcept
+  {
+    return {data_ + index * canvas_size_, canvas_size_};
+  }
+
+private:
+  canvases(std::uint8_t* data, std::size_t canvas_size, std::size_t size)
+      : data_(data)
+      , canvas_size_(canvas_size)
+      , size_(size)
+  {
+  }
+
+  std::uint8_t* data_;
+  std::size_t canvas_size_;
+  std::size_t size_;
+};
+
+/**
+ * Owns a gif_timeline populated by ::gif_timeline_build.
+ */
+class timeline
+{
+public:
+  static timeline build(
+      const details& source,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+  {
+    const detail::resource_scope scope(resource);
+    timeline result;
+    check(gif_timeline_build(
+        &source.get(), &result.timeline_, &detail::reallocate_function));
+    return result;
+  }
+
+  timeline(timeline&& other) noexcept
+      : timeline_(std::exchange(other.timeline_, gif_timeline {}))
+  {
+  }
+
+  timeline& operator=(timeline&& other) noexcept
+  {
+    if (this != &other) {
+      detail::deallocate(timeline_.frame_ends);
+      timeline_ = std::exchange(other.timeline_, gif_timeline {});
+    }
+
+    return *this;
+  }
+
+  timeline(const timeline&) = delete;
+  timeline& operator=(const timeline&) = delete;
+
+  ~timeline() { detail::deallocate(timeline_.frame_ends); }
+
+  const gif_timeline& get() const noexcept { return timeline_; }
+
+  std::size_t frame_at(std::uint64_t time) const noexcept
+  {
+    return gif_timeline_frame_at(&timeline_, time);
+  }
+
+private:
+  timeline() noexcept = default;
+
+  gif_timeline timeline_ {};
+};
+
+/**
+ * Owns a gif_context, whose kept memory comes from \c resource.
+ */
+class context
+{
+public:
+  explicit context(
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : resource_(resource)
+  {
+    gif_context_init(&context_,
+                     &detail::reallocate_function,
+                     &detail::deallocate_function);
+  }
+
+  context(context&& other) noexcept
+      : context_(other.context_)
+      , resource_(other.resource_)
+  {
+    gif_context_init(&other.context_,
+                     &detail::reallocate_function,
+                     &detail::deallocate_function);
+  }
+
+  context& operator=(context&& other) noexcept
+  {
+    if (this != &other) {
+      gif_context_free(&context_);
+      context_ = other.context_;
+      resource_ = other.resource_;
+      gif_context_init(&other.context_,
+                       &detail::reallocate_function,
+                       &detail::deallocate_function);
+    }
+
+    return *this;
+  }
+
+  context(const context&) = delete;
+  context& operator=(const context&) = delete;
+
+  ~context() { gif_context_free(&context_); }
+
+  /**
+   * Parses \c buffer, replacing the file parsed before. The returned details
+   * stay valid until the next call to this function or ::trim.
+   */
+  const gif_details& parse(const void* buffer,
+                           std::size_t size,
+                           const gif_parse_options* options = nullptr)
+  {
+    const detail::resource_scope scope(resource_);
+    check(gif_context_parse(&context_, buffer, size, options).code);
+    return context_.details;
+  }
+
+  /**
+   * Decodes the file parsed last. The canvases stay valid until the next call
+   * to this function or ::trim.
+   */
+  span<const std::uint8_t> decode()
+  {
+    const detail::resource_scope scope(resource_);
+    const gif_decode_result decode_result = gif_context_decode(&context_);
+    check(decode_result.code);
+
+    const gif_details& parsed = context_.details;
+    const std::size_t size = std::size_t {parsed.descriptor.canvas_width}
+        * parsed.descriptor.canvas_height * 4U * parsed.frame_vector.size;
+    return {static_cast<const std::uint8_t*>(decode_result.data), size};
+  }
+
+  void trim() noexcept { gif_context_trim(&context_); }
+
+  gif_context& get() noexcept { return context_; }
+
+private:
+  gif_context context_ {};
+  std::pmr::memory_resource* resource_;
+};
+}  // namespace gif
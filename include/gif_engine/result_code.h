@@ -34,4 +34,33 @@ typedef enum gif_result_code {
   GIF_FRAME_DATA_EMPTY,
 
   GIF_ZERO_SIZED_BUFFER,
+
+  GIF_LZW_INVALID_MIN_CODE_SIZE,
+  GIF_LZW_INVALID_CODE,
+  GIF_LZW_OUTPUT_OVERFLOW,
+  GIF_LZW_EARLY_END,
+
+  GIF_CANVAS_LIMIT_EXCEEDED,
+  GIF_FRAME_LIMIT_EXCEEDED,
+  GIF_DECODED_SIZE_LIMIT_EXCEEDED,
+  GIF_MEMORY_LIMIT_EXCEEDED,
+  GIF_FRAME_OUTPUT_LIMIT_EXCEEDED,
+
+  GIF_FRAME_INDEX_OUT_OF_RANGE,
+  GIF_INVALID_DECODE_TARGET,
+
+  GIF_INDEX_BUFFER_TOO_SMALL,
+  GIF_INDEX_INVALID,
+  GIF_INDEX_VERSION_MISMATCH,
+  GIF_INDEX_DATA_MISMATCH,
+
+  GIF_FRAME_TABLE_OFFSET_OVERFLOW,
+
+  GIF_SPILL_FAIL,
+
+  GIF_SIMD_LEVEL_UNSUPPORTED,
+
+  GIF_SOURCE_READ_FAIL,
+
+  GIF_INDEXED_UNSUPPORTED,
 } gif_result_code;
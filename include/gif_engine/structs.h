@@ -76,8 +76,22 @@ typedef struct gif_frame_data {
 
   gif_frame_descriptor descriptor;
 
+  /**
+   * Points past the length byte of the first sub-block of the image data, or
+   * \c NULL if the details were parsed from a gif_source.
+   */
   const uint8_t* first_subblock;
   size_t data_length;
+
+  /** Offset of \c first_subblock from the start of the file. */
+  uint64_t data_offset;
+
+  /**
+   * Hash of everything that determines the pixels of this frame: its
+   * descriptor, local color table, transparency and compressed data. Frames
+   * with equal fingerprints decode to the same pixels.
+   */
+  uint64_t fingerprint;
 } gif_frame_data;
 
 typedef struct gif_frame_vector {
@@ -86,6 +100,80 @@ typedef struct gif_frame_vector {
   size_t capacity;
 } gif_frame_vector;
 
+/**
+ * An application extension other than the NETSCAPE2.0 looping extension, like
+ * XMP metadata or an ICC profile. Its data is not copied out of the file.
+ */
+typedef struct gif_application_extension {
+  /** The application identifier followed by the authentication code. */
+  uint8_t identifier[11];
+
+  /** Index of the frame the extension comes before. */
+  size_t frame_index;
+
+  /**
+   * Points at the length byte of the first sub-block of the data, or \c NULL
+   * if the details were parsed from a gif_source. The data is a chain of
+   * sub-blocks, each a length byte followed by that many bytes, up to and
+   * including the terminating 0 length byte, \c size bytes in all.
+   */
+  const uint8_t* subblocks;
+  size_t size;
+
+  /** Offset of \c subblocks from the start of the file. */
+  uint64_t offset;
+} gif_application_extension;
+
+typedef struct gif_application_extension_vector {
+  gif_application_extension* extensions;
+  size_t size;
+  size_t capacity;
+} gif_application_extension_vector;
+
+/**
+ * Upper bounds on the resources a single file may consume. A value of 0 means
+ * there is no limit. Exceeding any of these makes the operation fail early
+ * with the matching \c GIF_*_LIMIT_EXCEEDED result code.
+ */
+typedef struct gif_limits {
+  /** Maximum width * height of the logical screen. */
+  uint64_t max_canvas_pixels;
+
+  /** Maximum number of frames. */
+  size_t max_frames;
+
+  /** Maximum size of the decoded output of all frames, at 4 bytes/pixel. */
+  uint64_t max_total_decoded_bytes;
+
+  /** Maximum number of bytes a single parse or decode call may allocate. */
+  size_t max_memory;
+
+  /** Maximum number of pixels the LZW stream of a single frame may produce. */
+  uint64_t max_frame_output;
+} gif_limits;
+
+/**
+ * Reads exactly \c size bytes at \c offset from the start of the file into
+ * \c buffer. Returns \c false if that is not possible.
+ */
+typedef bool (*gif_read_function)(void* context,
+                                  uint64_t offset,
+                                  void* buffer,
+                                  size_t size);
+
+/**
+ * A file read on demand instead of being held in memory as a whole. Frames may
+ * be decoded on the workers of an executor, so \c read must be safe to call
+ * from any thread, as \c pread is.
+ */
+typedef struct gif_source {
+  gif_read_function read;
+  void* context;
+
+  /** Size of the file in bytes. */
+  uint64_t size;
+} gif_source;
+
 typedef struct gif_details {
   gif_descriptor descriptor;
 
@@ -93,12 +181,264 @@ typedef struct gif_details {
 
   uint16_t repeat_count;
 
+  /**
+   * Whether the file has a NETSCAPE2.0 extension. Without one, the animation
+   * is played only once and \c repeat_count is 0.
+   */
+  bool has_loop_extension;
+
   gif_frame_vector frame_vector;
 
+  /**
+   * The application extensions found in the file, if they were asked for with
+   * the \c keep_application_extensions member of gif_parse_options.
+   */
+  gif_application_extension_vector application_extensions;
+
+  /** The buffer the details were parsed from, which frame data points into. */
   const uint8_t* raw_data;
   size_t raw_data_size;
+
+  /**
+   * The source the details were parsed from, in which case \c raw_data is
+   * \c NULL. Image data is read from it again when decoding.
+   */
+  const gif_source* source;
+
+  gif_limits limits;
+
+  /** Whether parsing stopped before the end of the file as requested. */
+  bool is_partial;
 } gif_details;
 
+/**
+ * Memory layout of a decoded pixel. Every format uses 4 bytes per pixel and
+ * the name lists the order of the channels in memory.
+ */
+typedef enum gif_pixel_format {
+  GIF_PIXEL_FORMAT_RGBA8888,
+  GIF_PIXEL_FORMAT_BGRA8888,
+} gif_pixel_format;
+
+/**
+ * Instruction set extensions the pixel and color table kernels can use. Each
+ * level implies the ones before it.
+ */
+typedef enum gif_simd_level {
+  GIF_SIMD_LEVEL_SCALAR,
+  GIF_SIMD_LEVEL_SSE2,
+  /** SSE4.1 along with SSSE3, which every CPU with SSE4.1 has. */
+  GIF_SIMD_LEVEL_SSE4,
+  GIF_SIMD_LEVEL_AVX2,
+  /** The foundation and the byte and word instructions of AVX-512. */
+  GIF_SIMD_LEVEL_AVX512,
+} gif_simd_level;
+
+/**
+ * The area of the image a decode target covers.
+ */
+typedef enum gif_target_region {
+  /**
+   * The target is the size of the logical screen. The frame is drawn at its
+   * offset and transparent pixels leave the target untouched.
+   */
+  GIF_TARGET_CANVAS,
+
+  /**
+   * The target is the size of the frame. Every pixel is written and
+   * transparent pixels are written with all channels set to 0.
+   */
+  GIF_TARGET_FRAME,
+} gif_target_region;
+
+/**
+ * Caller owned memory to decode pixels into.
+ */
+typedef struct gif_decode_target {
+  void* pixels;
+
+  /** Distance in bytes between the starts of two consecutive rows. */
+  size_t stride;
+
+  gif_pixel_format format;
+
+  gif_target_region region;
+
+  /**
+   * If not 0, then the target is laid out in square tiles with sides of this
+   * many pixels instead of rows, and \c stride is ignored. The tiles follow
+   * each other in row-major order, and each tile stores its pixels in
+   * row-major order without padding. Tiles on the right and bottom edges are
+   * stored at full size, so a target of \c width * \c height pixels takes
+   * <tt>ceil(width / tile_size) * ceil(height / tile_size)</tt> tiles of
+   * <tt>tile_size * tile_size * 4</tt> bytes each.
+   */
+  uint16_t tile_size;
+} gif_decode_target;
+
+/**
+ * Canvases composed by ::gif_decode_to_store. Canvas \c i starts at
+ * <tt>canvases + i * canvas_size</tt> and is laid out like the canvases
+ * returned by ::gif_decode.
+ */
+typedef struct gif_frame_store {
+  uint8_t* canvases;
+
+  /** Size of a single canvas in bytes. */
+  size_t canvas_size;
+
+  /** Number of canvases. */
+  size_t size;
+
+  /**
+   * Whether the canvases live in a memory mapped temporary file instead of
+   * memory from the allocator.
+   */
+  bool spilled;
+
+  size_t allocation_size;
+  void* cleanup_data[2];
+} gif_frame_store;
+
+/**
+ * Canvases composed by ::gif_decode_indexed, which are stored as palette
+ * indices instead of colors. Canvas \c i starts at
+ * <tt>indices + i * canvas_size</tt> and has a byte per pixel without any row
+ * padding.
+ */
+typedef struct gif_indexed_frames {
+  uint8_t* indices;
+
+  /** Size of a single canvas in bytes. */
+  size_t canvas_size;
+
+  /** Number of canvases. */
+  size_t size;
+
+  uint16_t canvas_width;
+  uint16_t canvas_height;
+
+  /**
+   * The colors every frame is drawn with, in the format of the color tables
+   * of gif_details. Indices past the color table are black.
+   */
+  uint32_t palette[256];
+
+  /** The index of fully transparent pixels, whose palette entry is unused. */
+  uint8_t transparent_index;
+} gif_indexed_frames;
+
+typedef struct gif_frame_rect {
+  uint16_t left;
+  uint16_t top;
+  uint16_t width;
+  uint16_t height;
+} gif_frame_rect;
+
+/**
+ * Statistics of the pixels a frame draws, gathered from its palette indices
+ * while it is being composed. See gif_decode_options.
+ */
+typedef struct gif_frame_analytics {
+  /** Number of pixels of the frame with each palette index. */
+  uint32_t index_histogram[256];
+
+  /** Whether any pixel of the frame has its transparent color index. */
+  bool has_transparency;
+
+  /**
+   * Smallest rectangle of the logical screen holding every pixel the frame
+   * draws, with a width and height of 0 if the frame is fully transparent.
+   */
+  gif_frame_rect opaque_bounds;
+
+  /** Mean color of the drawn pixels in the \c 0x00RRGGBB format. */
+  uint32_t average_color;
+
+  /**
+   * Average hash of the frame: bit <tt>y * 8 + x</tt> is set if the mean luma
+   * of cell (x, y) of an 8x8 grid over the frame is above the mean of all
+   * cells. Transparent pixels count as black.
+   */
+  uint64_t average_hash;
+} gif_frame_analytics;
+
+/**
+ * Per frame fields that are rarely needed when walking a gif_frame_table.
+ */
+typedef struct gif_frame_table_cold {
+  uint64_t fingerprint;
+
+  /** Borrowed from the gif_details struct the table was built from. */
+  const uint32_t* local_color_table;
+
+  gif_frame_descriptor_packed descriptor_packed;
+
+  uint8_t min_code_size;
+
+  bool user_input_flag;
+
+  bool transparent_color_flag;
+
+  uint8_t transparent_color_index;
+} gif_frame_table_cold;
+
+/**
+ * Structure of arrays view of the frames of a gif_details struct. Every array
+ * has \c size elements and the element at index \c i belongs to frame \c i.
+ * The fields walked by decoding, seeking and timeline operations are stored in
+ * their own dense arrays, so e.g. summing the delays of a hundred frames reads
+ * only 200 contiguous bytes.
+ */
+typedef struct gif_frame_table {
+  size_t size;
+
+  /** Offset of the data of the first sub-block from the start of the file. */
+  uint32_t* data_offsets;
+
+  /** Total number of bytes in the sub-blocks. */
+  uint32_t* data_lengths;
+
+  gif_frame_rect* rects;
+
+  /** Delays in hundredths of a second. */
+  uint16_t* delays;
+
+  /** ::gif_disposal_method values. */
+  uint8_t* disposal_methods;
+
+  gif_frame_table_cold* cold;
+} gif_frame_table;
+
+/**
+ * Playback schedule of an animation built by ::gif_timeline_build. Times are
+ * in milliseconds from the start of the animation.
+ */
+typedef struct gif_timeline {
+  /**
+   * Time at which each frame gets replaced by the next one. Frame \c i is
+   * visible from <tt>frame_ends[i - 1]</tt>, or 0 for the first frame, until
+   * <tt>frame_ends[i]</tt>.
+   */
+  uint64_t* frame_ends;
+  size_t size;
+
+  /** Length of a single loop of the animation. Never 0. */
+  uint64_t duration;
+
+  /**
+   * Number of times the animation repeats after the first play, or 0 if it
+   * loops forever.
+   */
+  uint16_t repeat_count;
+
+  /**
+   * Whether \c repeat_count came from a NETSCAPE2.0 extension. If it did not,
+   * the animation is played once regardless of \c repeat_count.
+   */
+  bool has_loop_extension;
+} gif_timeline;
+
 typedef struct gif_frame_span {
   const uint32_t* data;
   size_t size;
@@ -1,83 +1,71 @@
 #pragma once
 
-#include <assert.h>
-#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
 #include "gif_engine/gif_engine.h"
 
-typedef enum compare_result {
-  CMP_OOB,
-  CMP_EQ,
-  CMP_NEQ,
-} compare_result;
-
-/**
- * A \c memcmp wrapper to compare \c current and \c data until \c data_size
- * length with bounds checking. This function will advance the pointer pointed
- * to by \c current by \c data_size if the read isn't OOB.
- *
- * @return Result of the equality comparison or an indication of OOB
- */
-compare_result buffer_is_eq(const uint8_t** current,
-                            size_t* remaining,
-                            const uint8_t* data,
-                            size_t data_size);
-
-/**
- * Reads an 8 bit number with bounds checking. This function will advance the
- * pointer pointed to by \c current by 1 if the read isn't OOB.
- *
- * @return \c true if the read isn't OOB, otherwise \c false
- */
-bool read_byte(const uint8_t** current,
-               size_t* remaining,
-               uint8_t* destination);
-
 /**
  * Reads an 8 bit number without bounds checking. This function will advance
  * the pointer pointed to by \c buffer by 1.
  */
-uint8_t read_byte_un(const uint8_t** buffer);
+static inline uint8_t read_byte_un(const uint8_t** const buffer)
+{
+  const uint8_t byte = **buffer;
+  ++*buffer;
+  return byte;
+}
 
 /**
- * Reads a 16 bit little-endian number with bounds checking. This function will
- * advance the pointer pointed to by \c current by 2 if the read isn't OOB.
- *
- * @return \c true if the read isn't OOB, otherwise \c false
+ * Reads a 16 bit little-endian number without bounds checking. This function
+ * will advance the pointer pointed to by \c buffer by 2.
  */
-bool read_le_short(const uint8_t** current,
-                   size_t* remaining,
-                   uint16_t* destination);
+static inline uint16_t read_le_short_un(const uint8_t** const buffer)
+{
+  const uint8_t* const pointer = *buffer;
+  const uint16_t low_byte = pointer[0];
+  const uint16_t high_byte = pointer[1];
+  *buffer += 2;
+  return (uint16_t)(high_byte << 8U | low_byte);
+}
 
 /**
- * Reads a 16 bit little-endian number without bounds checking. This function
- * will advance the pointer pointed to by \c buffer by 2.
+ * Returns the size of the file \c details were parsed from.
  */
-uint16_t read_le_short_un(const uint8_t** buffer);
+static inline uint64_t input_size(const gif_details* const details)
+{
+  return details->source != NULL ? details->source->size
+                                 : details->raw_data_size;
+}
 
 /**
- * Skips \c count number of bytes with bounds checking. This function will
- * advance the pointer pointed to by \c current by \c count.
+ * Returns the number of bytes a color table of the given \c size occupies in
+ * the file.
  */
-bool skip_bytes(const uint8_t** current, size_t* remaining, size_t count);
+size_t color_table_byte_size(uint8_t size);
 
 /**
- * Reads a 3 byte color in the RGB format. This function will advance the
- * pointer pointed to by \c current by 3.
- *
- * @return 32 bit integer in the \c 0x00RRGGBB format that encodes an RGB color
+ * Returns the number of bytes ::read_color_table allocates for a color table
+ * of the given \c size.
  */
-uint32_t read_color_un(const uint8_t** buffer);
+size_t color_table_allocation_size(uint8_t size);
 
 /**
- * Reads a color table. This function will advance the pointer pointed to by \c
- * current by <tt>(2 &lt;&lt; size) * 3</tt>. The allocated color table will be
- * output via the \c destination parameter.
+ * Reads a color table without bounds checking, so the caller must make sure
+ * that at least <tt>color_table_byte_size(size)</tt> bytes are available. This
+ * function will advance the pointer pointed to by \c current by that many
+ * bytes. The allocated color table will be output via the \c destination
+ * parameter.
  */
 gif_result_code read_color_table(const uint8_t** current,
-                                 size_t* remaining,
                                  uint32_t** destination,
                                  uint8_t size,
                                  gif_allocator allocator);
+
+/**
+ * Same as ::read_color_table, but the colors are written to \c destination,
+ * which must have room for <tt>color_table_allocation_size(size)</tt> bytes.
+ */
+void read_color_table_into(const uint8_t** current,
+                           uint32_t* destination,
+                           uint8_t size);
@@ -0,0 +1,93 @@
+#include "context/context.h"
+
+#include <stdint.h>
+#include <string.h>
+
+void gif_context_init_impl(gif_context* const context,
+                           const gif_allocator allocator,
+                           const gif_deallocator deallocator)
+{
+  memset(context, 0, sizeof(gif_context));
+  context->allocator = allocator;
+  context->deallocator = deallocator;
+}
+
+static bool is_pooled(const gif_context* const context,
+                      const uint32_t* const colors)
+{
+  const uintptr_t address = (uintptr_t)colors;
+  const uintptr_t pool = (uintptr_t)context->color_pool;
+  return address >= pool
+      && address - pool < context->color_pool_capacity * sizeof(uint32_t);
+}
+
+static void free_unpooled(const gif_context* const context,
+                          uint32_t* const colors)
+{
+  if (colors != NULL && !is_pooled(context, colors)) {
+    context->deallocator(colors);
+  }
+}
+
+/**
+ * Frees the color tables that did not fit the pool.
+ */
+static void free_overflow(gif_context* const context)
+{
+  const gif_details* const details = &context->details;
+  free_unpooled(context, details->global_color_table);
+
+  const gif_frame_vector* const frame_vector = &details->frame_vector;
+  for (size_t i = 0; i < frame_vector->size; ++i) {
+    free_unpooled(context, frame_vector->frames[i].local_color_table);
+  }
+}
+
+static void clear_details(gif_context* const context)
+{
+  const gif_frame_vector frame_vector = context->details.frame_vector;
+  const gif_application_extension_vector application_extensions =
+      context->details.application_extensions;
+  memset(&context->details, 0, sizeof(gif_details));
+  context->details.frame_vector = (gif_frame_vector) {
+      .frames = frame_vector.frames,
+      .size = 0,
+      .capacity = frame_vector.capacity,
+  };
+  context->details.application_extensions =
+      (gif_application_extension_vector) {
+          .extensions = application_extensions.extensions,
+          .size = 0,
+          .capacity = application_extensions.capacity,
+      };
+  context->color_pool_used = 0;
+}
+
+void gif_context_reset_impl(gif_context* const context)
+{
+  const size_t overflow = context->color_pool_overflow;
+  if (overflow == 0) {
+    clear_details(context);
+    return;
+  }
+
+  free_overflow(context);
+  context->color_pool_overflow = 0;
+
+  /* Nothing points into the pool anymore, so it is not copied */
+  const size_t capacity = context->color_pool_used + overflow;
+  context->deallocator(context->color_pool);
+  context->color_pool = context->allocator(NULL, capacity * sizeof(uint32_t));
+  context->color_pool_capacity = context->color_pool == NULL ? 0 : capacity;
+  clear_details(context);
+}
+
+void gif_context_trim_impl(gif_context* const context)
+{
+  free_overflow(context);
+  context->deallocator(context->details.frame_vector.frames);
+  context->deallocator(context->details.application_extensions.extensions);
+  context->deallocator(context->color_pool);
+  context->deallocator(context->canvases);
+  gif_context_init_impl(context, context->allocator, context->deallocator);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "gif_engine/gif_engine.h"
+
+void gif_context_init_impl(gif_context* context,
+                           gif_allocator allocator,
+                           gif_deallocator deallocator);
+
+/**
+ * Discards the file parsed last, keeping the memory the context holds. This
+ * is O(1) unless color tables overflowed the pool, in which case they are
+ * freed and the pool grows to fit them all.
+ */
+void gif_context_reset_impl(gif_context* context);
+
+void gif_context_trim_impl(gif_context* context);
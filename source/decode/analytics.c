@@ -0,0 +1,206 @@
+#include "decode/analytics.h"
+
+#include <string.h>
+
+#define ANALYTICS_CELL_COUNT (ANALYTICS_GRID_SIZE * ANALYTICS_GRID_SIZE)
+
+/**
+ * Approximates the BT.601 luma of a \c 0x00RRGGBB color in fixed point.
+ */
+static uint8_t color_luma(const uint32_t color)
+{
+  const uint32_t red = (color >> 16U) & 0xFFU;
+  const uint32_t green = (color >> 8U) & 0xFFU;
+  const uint32_t blue = color & 0xFFU;
+  return (uint8_t)((77U * red + 150U * green + 29U * blue) >> 8U);
+}
+
+void frame_analytics_begin(frame_analytics* const analytics,
+                           gif_frame_analytics* const result,
+                           const gif_details* const details,
+                           const gif_frame_data* const frame)
+{
+  memset(analytics, 0, sizeof(frame_analytics));
+  memset(result, 0, sizeof(gif_frame_analytics));
+  analytics->result = result;
+  analytics->frame = frame;
+
+  if (frame->descriptor.packed.local_color_table_flag) {
+    analytics->color_table = frame->local_color_table;
+    analytics->color_count = 2U << frame->descriptor.packed.size;
+  } else if (details->descriptor.packed.global_color_table_flag) {
+    analytics->color_table = details->global_color_table;
+    analytics->color_count = 2U << details->descriptor.packed.size;
+  }
+
+  /* Indices past the end of the color table are drawn black */
+  for (size_t i = 0; i < analytics->color_count; ++i) {
+    analytics->luma[i] = color_luma(analytics->color_table[i]);
+  }
+
+  const gif_graphic_extension* const extension = &frame->graphic_extension;
+  analytics->has_transparent_index = extension->packed.transparent_color_flag;
+  analytics->transparent_index = extension->transparent_color_index;
+  if (analytics->has_transparent_index) {
+    analytics->luma[analytics->transparent_index] = 0;
+  }
+
+  const size_t width = frame->descriptor.width;
+  for (size_t i = 0; i < ANALYTICS_GRID_SIZE; ++i) {
+    analytics->column_ends[i] =
+        ((i + 1U) * width + ANALYTICS_GRID_SIZE - 1U) / ANALYTICS_GRID_SIZE;
+  }
+
+  analytics->left = SIZE_MAX;
+  analytics->top = SIZE_MAX;
+}
+
+/**
+ * Widens the opaque bounds to the opaque pixels of the span, which are found
+ * by scanning inwards from both ends.
+ */
+static void add_bounds(frame_analytics* const analytics,
+                       const uint8_t* const indices,
+                       const size_t count,
+                       const size_t x,
+                       const size_t y)
+{
+  size_t first = 0;
+  size_t last = count;
+  if (analytics->has_transparent_index) {
+    const uint8_t transparent_index = analytics->transparent_index;
+    while (first != count && indices[first] == transparent_index) {
+      ++first;
+    }
+    while (last != first && indices[last - 1U] == transparent_index) {
+      --last;
+    }
+  }
+
+  if (first == last) {
+    return;
+  }
+
+  if (x + first < analytics->left) {
+    analytics->left = x + first;
+  }
+  if (x + last - 1U > analytics->right) {
+    analytics->right = x + last - 1U;
+  }
+  if (y < analytics->top) {
+    analytics->top = y;
+  }
+  if (y > analytics->bottom) {
+    analytics->bottom = y;
+  }
+}
+
+void frame_analytics_add(frame_analytics* const analytics,
+                         const uint8_t* const indices,
+                         const size_t count,
+                         const size_t x,
+                         const size_t y)
+{
+  add_bounds(analytics, indices, count, x, y);
+
+  uint32_t* const histogram = analytics->result->index_histogram;
+  const uint8_t* const luma = analytics->luma;
+  const size_t height = analytics->frame->descriptor.height;
+  const size_t cell_row = y * ANALYTICS_GRID_SIZE / height;
+  uint64_t* const sums = &analytics->cell_sums[cell_row * ANALYTICS_GRID_SIZE];
+  uint64_t* const counts =
+      &analytics->cell_counts[cell_row * ANALYTICS_GRID_SIZE];
+
+  /* Only the column of the grid changes along a span, so the span is split
+   * at the column ends and each piece is summed into a single cell */
+  size_t i = 0;
+  size_t column = 0;
+  while (i != count) {
+    while (analytics->column_ends[column] <= x + i) {
+      ++column;
+    }
+
+    const size_t column_end = analytics->column_ends[column] - x;
+    const size_t end = column_end < count ? column_end : count;
+    uint64_t sum = 0;
+    for (size_t j = i; j < end; ++j) {
+      const uint8_t index = indices[j];
+      ++histogram[index];
+      sum += luma[index];
+    }
+
+    sums[column] += sum;
+    counts[column] += end - i;
+    i = end;
+  }
+}
+
+static uint32_t average_color(const frame_analytics* const analytics)
+{
+  const uint32_t* const histogram = analytics->result->index_histogram;
+  uint64_t channels[3] = {0};
+  uint64_t pixel_count = 0;
+  for (size_t i = 0; i < 256U; ++i) {
+    if (analytics->has_transparent_index && i == analytics->transparent_index)
+    {
+      continue;
+    }
+
+    pixel_count += histogram[i];
+    if (i >= analytics->color_count) {
+      continue;
+    }
+
+    const uint32_t color = analytics->color_table[i];
+    channels[0] += (uint64_t)((color >> 16U) & 0xFFU) * histogram[i];
+    channels[1] += (uint64_t)((color >> 8U) & 0xFFU) * histogram[i];
+    channels[2] += (uint64_t)(color & 0xFFU) * histogram[i];
+  }
+
+  if (pixel_count == 0) {
+    return 0;
+  }
+
+  return (uint32_t)(channels[0] / pixel_count) << 16U
+      | (uint32_t)(channels[1] / pixel_count) << 8U
+      | (uint32_t)(channels[2] / pixel_count);
+}
+
+static uint64_t average_hash(const frame_analytics* const analytics)
+{
+  uint64_t means[ANALYTICS_CELL_COUNT];
+  uint64_t total = 0;
+  for (size_t i = 0; i < ANALYTICS_CELL_COUNT; ++i) {
+    const uint64_t count = analytics->cell_counts[i];
+    means[i] = count == 0 ? 0 : analytics->cell_sums[i] / count;
+    total += means[i];
+  }
+
+  const uint64_t mean = total / ANALYTICS_CELL_COUNT;
+  uint64_t hash = 0;
+  for (size_t i = 0; i < ANALYTICS_CELL_COUNT; ++i) {
+    hash |= (uint64_t)(means[i] > mean) << i;
+  }
+
+  return hash;
+}
+
+void frame_analytics_finish(const frame_analytics* const analytics)
+{
+  gif_frame_analytics* const result = analytics->result;
+  result->has_transparency = analytics->has_transparent_index
+      && result->index_histogram[analytics->transparent_index] != 0;
+  result->average_color = average_color(analytics);
+  result->average_hash = average_hash(analytics);
+
+  if (analytics->top != SIZE_MAX) {
+    const gif_frame_descriptor* const descriptor =
+        &analytics->frame->descriptor;
+    result->opaque_bounds = (gif_frame_rect) {
+        .left = (uint16_t)(descriptor->left + analytics->left),
+        .top = (uint16_t)(descriptor->top + analytics->top),
+        .width = (uint16_t)(analytics->right - analytics->left + 1U),
+        .height = (uint16_t)(analytics->bottom - analytics->top + 1U),
+    };
+  }
+}
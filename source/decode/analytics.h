@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gif_engine/gif_engine.h"
+
+#define ANALYTICS_GRID_SIZE 8U
+
+/**
+ * Running statistics of a single frame. The pixels of the frame are fed to it
+ * in spans of palette indices, in any order.
+ */
+typedef struct frame_analytics {
+  gif_frame_analytics* result;
+  const gif_frame_data* frame;
+  const uint32_t* color_table;
+  size_t color_count;
+
+  /* Luma of each palette index, with transparent pixels counting as black */
+  uint8_t luma[256];
+  bool has_transparent_index;
+  uint8_t transparent_index;
+
+  /* Exclusive end of each grid column and the grid cell sums */
+  size_t column_ends[ANALYTICS_GRID_SIZE];
+  uint64_t cell_sums[ANALYTICS_GRID_SIZE * ANALYTICS_GRID_SIZE];
+  uint64_t cell_counts[ANALYTICS_GRID_SIZE * ANALYTICS_GRID_SIZE];
+
+  /* Bounds of the opaque pixels in frame coordinates, with top left at
+   * SIZE_MAX while none were seen */
+  size_t left;
+  size_t top;
+  size_t right;
+  size_t bottom;
+} frame_analytics;
+
+void frame_analytics_begin(frame_analytics* analytics,
+                           gif_frame_analytics* result,
+                           const gif_details* details,
+                           const gif_frame_data* frame);
+
+/**
+ * Adds \c count pixels starting at (\c x, \c y) of the frame.
+ */
+void frame_analytics_add(frame_analytics* analytics,
+                         const uint8_t* indices,
+                         size_t count,
+                         size_t x,
+                         size_t y);
+
+/**
+ * Derives the remaining statistics and writes them to the result.
+ */
+void frame_analytics_finish(const frame_analytics* analytics);
@@ -0,0 +1,104 @@
+#include "decode/compose.h"
+
+#include <string.h>
+
+#include "work.h"
+
+static uint32_t pack_color(const uint32_t color, const gif_pixel_format format)
+{
+  const uint8_t red = (uint8_t)(color >> 16U);
+  const uint8_t green = (uint8_t)(color >> 8U);
+  const uint8_t blue = (uint8_t)color;
+
+  uint8_t bytes[COMPOSE_PIXEL_SIZE] = {red, green, blue, 0xFF};
+  if (format == GIF_PIXEL_FORMAT_BGRA8888) {
+    bytes[0] = blue;
+    bytes[2] = red;
+  }
+
+  uint32_t packed;
+  memcpy(&packed, bytes, sizeof(packed));
+  return packed;
+}
+
+const uint32_t* compose_color_table(const gif_details* const details,
+                                    const gif_frame_data* const frame,
+                                    size_t* const color_count)
+{
+  if (frame->descriptor.packed.local_color_table_flag) {
+    *color_count = 2U << frame->descriptor.packed.size;
+    return frame->local_color_table;
+  }
+
+  if (details->descriptor.packed.global_color_table_flag) {
+    *color_count = 2U << details->descriptor.packed.size;
+    return details->global_color_table;
+  }
+
+  *color_count = 0;
+  return NULL;
+}
+
+void compose_palette_init_table(compose_palette* const palette,
+                                const uint32_t* const color_table,
+                                const size_t color_count,
+                                const gif_pixel_format format)
+{
+  for (size_t i = 0; i < color_count; ++i) {
+    palette->colors[i] = pack_color(color_table[i], format);
+  }
+
+  palette->kernels = simd_kernels_get();
+
+  const uint32_t black = pack_color(0, format);
+  for (size_t i = color_count; i < COMPOSE_PALETTE_SIZE; ++i) {
+    palette->colors[i] = black;
+  }
+
+  palette->has_transparency = false;
+  palette->transparent_index = 0;
+}
+
+void compose_palette_init(compose_palette* const palette,
+                          const gif_details* const details,
+                          const gif_frame_data* const frame,
+                          const gif_pixel_format format,
+                          const bool keep_transparent)
+{
+  size_t color_count;
+  const uint32_t* const color_table =
+      compose_color_table(details, frame, &color_count);
+  compose_palette_init_table(palette, color_table, color_count, format);
+
+  const gif_graphic_extension* const extension = &frame->graphic_extension;
+  const bool has_transparency = extension->packed.transparent_color_flag;
+  palette->transparent_index = extension->transparent_color_index;
+  palette->has_transparency = has_transparency && keep_transparent;
+  if (has_transparency && !keep_transparent) {
+    palette->colors[extension->transparent_color_index] = 0;
+  }
+}
+
+void compose_span(uint8_t* const destination,
+                  const uint8_t* const indices,
+                  const size_t count,
+                  const compose_palette* const palette)
+{
+  COUNT_WORK(pixels_written, count);
+
+  /* Most frames either have no transparent color or only use it in some of
+   * their rows, so a cheap scan of the span decides whether blending can be
+   * skipped entirely */
+  if (!palette->has_transparency
+      || memchr(indices, palette->transparent_index, count) == NULL)
+  {
+    palette->kernels->expand(destination, indices, count, palette->colors);
+    return;
+  }
+
+  palette->kernels->blend(destination,
+                          indices,
+                          count,
+                          palette->colors,
+                          palette->transparent_index);
+}
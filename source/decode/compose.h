@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gif_engine/gif_engine.h"
+#include "simd/simd.h"
+
+#define COMPOSE_PIXEL_SIZE 4U
+#define COMPOSE_PALETTE_SIZE 256U
+
+/**
+ * The color table of a frame expanded to all 256 possible indices, with each
+ * color already laid out in the byte order of the target pixel format.
+ */
+typedef struct compose_palette {
+  uint32_t colors[COMPOSE_PALETTE_SIZE];
+
+  bool has_transparency;
+  uint8_t transparent_index;
+
+  /** Captured once per frame, so forcing a level never affects a span. */
+  const simd_kernels* kernels;
+} compose_palette;
+
+/**
+ * Returns the color table \c frame is drawn with, which is its local color
+ * table or the global one, and outputs its number of colors via the
+ * \c color_count parameter. Returns \c NULL if there is neither.
+ */
+const uint32_t* compose_color_table(const gif_details* details,
+                                    const gif_frame_data* frame,
+                                    size_t* color_count);
+
+/**
+ * Prepares a palette of the \c color_count colors of \c color_table for
+ * writing pixels in \c format, without a transparent color. Indices not
+ * covered by the color table map to opaque black.
+ */
+void compose_palette_init_table(compose_palette* palette,
+                                const uint32_t* color_table,
+                                size_t color_count,
+                                gif_pixel_format format);
+
+/**
+ * Prepares the palette of \c frame for writing pixels in \c format. Indices
+ * not covered by the color table of the frame map to opaque black.
+ *
+ * If \c keep_transparent is \c true, then pixels with the transparent index of
+ * the frame are skipped by ::compose_span, otherwise they are written with
+ * every channel set to 0.
+ */
+void compose_palette_init(compose_palette* palette,
+                          const gif_details* details,
+                          const gif_frame_data* frame,
+                          gif_pixel_format format,
+                          bool keep_transparent);
+
+/**
+ * Writes the colors of \c count palette indices to \c destination.
+ */
+void compose_span(uint8_t* destination,
+                  const uint8_t* indices,
+                  size_t count,
+                  const compose_palette* palette);
@@ -1,12 +1,1504 @@
 #include "decode/decode.h"
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "decode/analytics.h"
+#include "decode/compose.h"
+#include "decode/lzw.h"
+#include "spill/spill.h"
+#include "try.h"
+#include "work.h"
+
+/* Rows are pulled out of the LZW decoder in pieces of at most this many
+ * pixels, so the index buffer can live on the stack */
+#define DECODE_CHUNK_SIZE 4096U
+
+/**
+ * Maps the n-th row in the order it appears in the image data to its position
+ * in the frame, following the 4 pass layout of interlaced frames.
+ */
+static size_t interlaced_row(size_t row, const size_t height)
+{
+  const size_t first_pass = (height + 7U) / 8U;
+  if (row < first_pass) {
+    return row * 8U;
+  }
+  row -= first_pass;
+
+  const size_t second_pass = (height + 3U) / 8U;
+  if (row < second_pass) {
+    return 4U + row * 8U;
+  }
+  row -= second_pass;
+
+  const size_t third_pass = (height + 1U) / 4U;
+  if (row < third_pass) {
+    return 2U + row * 4U;
+  }
+  row -= third_pass;
+
+  return 1U + row * 2U;
+}
+
+/**
+ * Maps pixel positions to byte offsets in a target, which is either laid out
+ * in rows or in tiles.
+ */
+typedef struct target_layout {
+  size_t stride;
+
+  /* Only used if tile_size is not 0 */
+  size_t tile_size;
+  size_t tile_bytes;
+  size_t tile_row_bytes;
+} target_layout;
+
+static void target_layout_init(target_layout* const layout,
+                               const size_t stride,
+                               const size_t tile_size,
+                               const size_t width)
+{
+  layout->stride = stride;
+  layout->tile_size = tile_size;
+  if (tile_size != 0) {
+    layout->stride = tile_size * COMPOSE_PIXEL_SIZE;
+    layout->tile_bytes = tile_size * layout->stride;
+    layout->tile_row_bytes =
+        (width + tile_size - 1U) / tile_size * layout->tile_bytes;
+  }
+}
+
+static size_t target_offset(const target_layout* const layout,
+                            const size_t x,
+                            const size_t y)
+{
+  const size_t tile_size = layout->tile_size;
+  if (tile_size == 0) {
+    return y * layout->stride + x * COMPOSE_PIXEL_SIZE;
+  }
+
+  const size_t tile_offset = y / tile_size * layout->tile_row_bytes
+      + x / tile_size * layout->tile_bytes;
+  return tile_offset + (y % tile_size) * layout->stride
+      + (x % tile_size) * COMPOSE_PIXEL_SIZE;
+}
+
+/**
+ * Returns how many of the \c count pixels starting at column \c x are
+ * contiguous in memory, which is all of them unless a tile edge comes first.
+ */
+static size_t target_run(const target_layout* const layout,
+                         const size_t x,
+                         const size_t count)
+{
+  const size_t tile_size = layout->tile_size;
+  if (tile_size == 0) {
+    return count;
+  }
+
+  const size_t run = tile_size - x % tile_size;
+  return run < count ? run : count;
+}
+
+/**
+ * A target with the position of the frame being drawn in it.
+ */
+typedef struct target_view {
+  uint8_t* pixels;
+  target_layout layout;
+  size_t left;
+  size_t top;
+} target_view;
+
+static void target_view_init(target_view* const view,
+                             const gif_details* const details,
+                             const gif_frame_data* const frame,
+                             const gif_decode_target* const target)
+{
+  const gif_frame_descriptor* const descriptor = &frame->descriptor;
+  const bool is_canvas = target->region == GIF_TARGET_CANVAS;
+  view->pixels = target->pixels;
+  view->left = is_canvas ? descriptor->left : 0U;
+  view->top = is_canvas ? descriptor->top : 0U;
+  target_layout_init(&view->layout,
+                     target->stride,
+                     target->tile_size,
+                     is_canvas ? details->descriptor.canvas_width
+                               : descriptor->width);
+}
+
+/**
+ * Writes the colors of \c count palette indices to row \c y of the frame in
+ * \c view, starting at column \c x.
+ */
+static void compose_row(const target_view* const view,
+                        size_t x,
+                        const size_t y,
+                        const uint8_t* indices,
+                        size_t count,
+                        const compose_palette* const palette)
+{
+  x += view->left;
+  while (count != 0) {
+    const size_t run = target_run(&view->layout, x, count);
+    compose_span(&view->pixels[target_offset(&view->layout, x, view->top + y)],
+                 indices,
+                 run,
+                 palette);
+    x += run;
+    indices += run;
+    count -= run;
+  }
+}
+
+static gif_result_code decode_frame(const gif_details* const details,
+                                    const gif_frame_data* const frame,
+                                    const gif_decode_target* const target,
+                                    frame_analytics* const analytics)
+{
+  lzw_decoder decoder;
+  TRY(lzw_decoder_init(&decoder, details->source, frame));
+
+  const bool is_canvas = target->region == GIF_TARGET_CANVAS;
+  compose_palette palette;
+  compose_palette_init(&palette, details, frame, target->format, is_canvas);
+
+  const gif_frame_descriptor* const descriptor = &frame->descriptor;
+  const size_t width = descriptor->width;
+  const size_t height = descriptor->height;
+  target_view view;
+  target_view_init(&view, details, frame, target);
+
+  uint8_t indices[DECODE_CHUNK_SIZE];
+  const bool is_interlaced = descriptor->packed.interlace_flag;
+  for (size_t row = 0; row < height; ++row) {
+    const size_t y = is_interlaced ? interlaced_row(row, height) : row;
+    for (size_t x = 0; x < width; x += DECODE_CHUNK_SIZE) {
+      const size_t left = width - x;
+      const size_t count = left < DECODE_CHUNK_SIZE ? left : DECODE_CHUNK_SIZE;
+      TRY(lzw_decoder_read(&decoder, indices, count));
+      compose_row(&view, x, y, indices, count, &palette);
+      if (analytics != NULL) {
+        frame_analytics_add(analytics, indices, count, x, y);
+      }
+    }
+  }
+
+  return lzw_decoder_finish(&decoder);
+}
+
+/* Frames are split into bands of roughly this many pixels. The LZW decoder
+ * fills one band while the workers compose the one before it. */
+#define DECODE_BAND_PIXELS (256U * 1024U)
+
+typedef struct band_job {
+  const gif_frame_descriptor* descriptor;
+  const compose_palette* palette;
+  const target_view* view;
+
+  lzw_decoder* decoder;
+  uint8_t* next_indices;
+  size_t next_rows;
+  gif_result_code decode_code;
+
+  const uint8_t* indices;
+  size_t first_row;
+  size_t rows;
+  size_t part_count;
+
+  /* Only supported with a single part */
+  frame_analytics* analytics;
+} band_job;
+
+static void band_decode(band_job* const job)
+{
+  const size_t count = job->next_rows * job->descriptor->width;
+  job->decode_code = lzw_decoder_read(job->decoder, job->next_indices, count);
+}
+
+static void band_compose(const band_job* const job, const size_t part)
+{
+  const gif_frame_descriptor* const descriptor = job->descriptor;
+  const size_t width = descriptor->width;
+  const size_t height = descriptor->height;
+  const bool is_interlaced = descriptor->packed.interlace_flag;
+  const size_t begin = job->rows * part / job->part_count;
+  const size_t end = job->rows * (part + 1U) / job->part_count;
+  for (size_t i = begin; i < end; ++i) {
+    const size_t row = job->first_row + i;
+    const size_t y = is_interlaced ? interlaced_row(row, height) : row;
+    compose_row(job->view, 0, y, &job->indices[i * width], width, job->palette);
+    if (job->analytics != NULL) {
+      frame_analytics_add(
+          job->analytics, &job->indices[i * width], width, 0, y);
+    }
+  }
+}
+
+/**
+ * Task 0 decodes the next band, if there is one, and the rest compose a part
+ * of the current band each.
+ */
+static void band_task(void* const context, const size_t index)
+{
+  band_job* const job = context;
+  if (index == 0) {
+    if (job->next_rows != 0) {
+      band_decode(job);
+    }
+    return;
+  }
+
+  band_compose(job, index - 1U);
+}
+
+static gif_result_code decode_frame_in_bands(
+    const gif_details* const details,
+    const gif_frame_data* const frame,
+    const gif_decode_target* const target,
+    const gif_executor* const executor,
+    uint8_t* const bands[2],
+    const size_t band_rows)
+{
+  lzw_decoder decoder;
+  TRY(lzw_decoder_init(&decoder, details->source, frame));
+
+  const bool is_canvas = target->region == GIF_TARGET_CANVAS;
+  compose_palette palette;
+  compose_palette_init(&palette, details, frame, target->format, is_canvas);
+
+  const gif_frame_descriptor* const descriptor = &frame->descriptor;
+  const size_t height = descriptor->height;
+
+  target_view view;
+  target_view_init(&view, details, frame, target);
+
+  const size_t first_rows = band_rows < height ? band_rows : height;
+  band_job job = {
+      .descriptor = descriptor,
+      .palette = &palette,
+      .view = &view,
+      .decoder = &decoder,
+      .next_indices = bands[0],
+      .next_rows = first_rows,
+      .decode_code = GIF_SUCCESS,
+      .part_count = executor->worker_count - 1U,
+  };
+  band_decode(&job);
+
+  size_t band = 0;
+  for (size_t row = 0; row < height; row += band_rows) {
+    TRY(job.decode_code);
+
+    job.indices = bands[band];
+    job.first_row = row;
+    job.rows = job.next_rows;
+
+    band ^= 1U;
+    const size_t next_row = row + job.rows;
+    const size_t left = height - next_row;
+    job.next_indices = bands[band];
+    job.next_rows = left < band_rows ? left : band_rows;
+
+    executor->run(executor->context, &band_task, &job, job.part_count + 1U);
+  }
+
+  return lzw_decoder_finish(&decoder);
+}
+
+static bool is_target_invalid(const gif_details* const details,
+                              const gif_frame_data* const frame,
+                              const gif_decode_target* const target)
+{
+  if (target->pixels == NULL) {
+    return true;
+  }
+
+  size_t width;
+  switch (target->region) {
+    case GIF_TARGET_CANVAS:
+      width = details->descriptor.canvas_width;
+      break;
+    case GIF_TARGET_FRAME:
+      width = frame->descriptor.width;
+      break;
+    default:
+      return true;
+  }
+
+  switch (target->format) {
+    case GIF_PIXEL_FORMAT_RGBA8888:
+    case GIF_PIXEL_FORMAT_BGRA8888:
+      break;
+    default:
+      return true;
+  }
+
+  return target->tile_size == 0 && target->stride < width * COMPOSE_PIXEL_SIZE;
+}
+
+gif_result_code gif_decode_frame_impl(const gif_details* const details,
+                                      const size_t frame_index,
+                                      const gif_decode_target* const target)
+{
+  if (frame_index >= details->frame_vector.size) {
+    return GIF_FRAME_INDEX_OUT_OF_RANGE;
+  }
+
+  const gif_frame_data* const frame =
+      &details->frame_vector.frames[frame_index];
+  if (is_target_invalid(details, frame, target)) {
+    return GIF_INVALID_DECODE_TARGET;
+  }
+
+  return decode_frame(details, frame, target, NULL);
+}
+
+gif_result_code gif_decode_frame_parallel_impl(
+    const gif_details* const details,
+    const size_t frame_index,
+    const gif_decode_target* const target,
+    const gif_executor* const executor,
+    const gif_allocator allocator,
+    const gif_deallocator deallocator)
+{
+  if (frame_index >= details->frame_vector.size) {
+    return GIF_FRAME_INDEX_OUT_OF_RANGE;
+  }
+
+  const gif_frame_data* const frame =
+      &details->frame_vector.frames[frame_index];
+  if (is_target_invalid(details, frame, target)) {
+    return GIF_INVALID_DECODE_TARGET;
+  }
+
+  /* Without a second worker there is nobody to compose while the LZW stream
+   * is being decoded */
+  if (executor == NULL || executor->worker_count < 2U) {
+    return decode_frame(details, frame, target, NULL);
+  }
+
+  /* Bands never take more rows than the frame has, so small frames do not
+   * pay for the full band size */
+  const size_t width = frame->descriptor.width;
+  const size_t height = frame->descriptor.height;
+  const size_t max_band_rows =
+      width < DECODE_BAND_PIXELS ? DECODE_BAND_PIXELS / width : 1U;
+  const size_t band_rows = max_band_rows < height ? max_band_rows : height;
+  const size_t band_bytes = band_rows * width;
+  uint8_t* const allocation = allocator(NULL, band_bytes * 2U);
+  if (allocation == NULL) {
+    return GIF_ALLOC_FAIL;
+  }
+
+  uint8_t* const bands[2] = {allocation, &allocation[band_bytes]};
+  const gif_result_code code = decode_frame_in_bands(
+      details, frame, target, executor, bands, band_rows);
+  deallocator(allocation);
+  return code;
+}
+
+/**
+ * Calls \c operation on each contiguous run of bytes the frame's rectangle
+ * covers in a canvas sized buffer, which is a row of the rectangle or the
+ * part of it within a tile. \c offset and \c length name the variables that
+ * hold the byte offset and byte length of the run.
+ */
+#define FOR_EACH_FRAME_RUN(descriptor, layout, offset, length, operation) \
+  do { \
+    const size_t right_ = (size_t)(descriptor)->left + (descriptor)->width; \
+    const size_t bottom_ = (size_t)(descriptor)->top + (descriptor)->height; \
+    for (size_t y_ = (descriptor)->top; y_ < bottom_; ++y_) { \
+      size_t x_ = (descriptor)->left; \
+      while (x_ < right_) { \
+        const size_t run_ = target_run((layout), x_, right_ - x_); \
+        const size_t offset = target_offset((layout), x_, y_); \
+        const size_t length = run_ * COMPOSE_PIXEL_SIZE; \
+        operation; \
+        x_ += run_; \
+      } \
+    } \
+  } while (0)
+
+/**
+ * Compares the compressed image data of two frames sub-block by sub-block.
+ * Data that is read from a gif_source is not at hand to compare, so it never
+ * counts as the same.
+ */
+static bool is_same_image_data(const gif_frame_data* const a,
+                               const gif_frame_data* const b)
+{
+  if (a->first_subblock == NULL || b->first_subblock == NULL) {
+    return false;
+  }
+
+  /* The chains were walked by the parser or the index loader already, so
+   * they end within the buffer */
+  const uint8_t* left = a->first_subblock - 1;
+  const uint8_t* right = b->first_subblock - 1;
+  while (1) {
+    const uint8_t subblock_size = *left;
+    if (subblock_size != *right) {
+      return false;
+    }
+
+    if (subblock_size == 0) {
+      return true;
+    }
+
+    if (memcmp(&left[1], &right[1], subblock_size) != 0) {
+      return false;
+    }
+
+    left += subblock_size + 1U;
+    right += subblock_size + 1U;
+  }
+}
+
+static bool is_same_color_table(const gif_details* const details,
+                                const gif_frame_data* const a,
+                                const gif_frame_data* const b)
+{
+  size_t a_count = 0;
+  size_t b_count = 0;
+  const uint32_t* const a_table = compose_color_table(details, a, &a_count);
+  const uint32_t* const b_table = compose_color_table(details, b, &b_count);
+  return a_count == b_count
+      && (a_table == b_table
+          || memcmp(a_table, b_table, a_count * sizeof(uint32_t)) == 0);
+}
+
+/**
+ * Checks whether drawing \c frame over the canvas of the frame before it would
+ * recreate the pixels that frame left behind. In that case the LZW stream of
+ * \c frame does not have to be decoded at all.
+ *
+ * The fingerprints only rule out most frames quickly. They are not collision
+ * resistant, so a crafted file could make different frames share one, and
+ * everything that determines the pixels is compared byte for byte instead.
+ */
+static bool is_repeat_of_previous(const gif_details* const details,
+                                  const gif_frame_data* const previous,
+                                  const gif_frame_data* const frame)
+{
+  const gif_frame_descriptor* const a = &previous->descriptor;
+  const gif_frame_descriptor* const b = &frame->descriptor;
+  if (previous->fingerprint != frame->fingerprint
+      || previous->data_length != frame->data_length || a->left != b->left
+      || a->top != b->top || a->width != b->width || a->height != b->height)
+  {
+    return false;
+  }
+
+  const gif_graphic_extension* const previous_extension =
+      &previous->graphic_extension;
+  const gif_graphic_extension* const extension = &frame->graphic_extension;
+  const bool is_transparent = extension->packed.transparent_color_flag;
+  if (previous->min_code_size != frame->min_code_size
+      || a->packed.interlace_flag != b->packed.interlace_flag
+      || previous_extension->packed.transparent_color_flag != is_transparent
+      || (is_transparent
+          && previous_extension->transparent_color_index
+              != extension->transparent_color_index)
+      || !is_same_color_table(details, previous, frame)
+      || !is_same_image_data(previous, frame))
+  {
+    return false;
+  }
+
+  /* With transparency, the pixels under the frame come through, so those
+   * must not have been disposed of */
+  switch (previous_extension->packed.disposal_method) {
+    case GIF_DISPOSAL_UNSPECIFIED:
+    case GIF_DISPOSAL_NOTHING:
+      return true;
+    default:
+      return !is_transparent;
+  }
+}
+
+static void dispose_frame(const gif_frame_data* const frame,
+                          uint8_t* const canvas,
+                          const uint8_t* const backup,
+                          const target_layout* const layout)
+{
+  const gif_frame_descriptor* const descriptor = &frame->descriptor;
+  switch (frame->graphic_extension.packed.disposal_method) {
+    case GIF_DISPOSAL_BACKGROUND:
+      FOR_EACH_FRAME_RUN(descriptor,
+                         layout,
+                         offset,
+                         length,
+                         memset(&canvas[offset], 0, length));
+      break;
+    case GIF_DISPOSAL_PREVIOUS:
+      FOR_EACH_FRAME_RUN(descriptor,
+                         layout,
+                         offset,
+                         length,
+                         memcpy(&canvas[offset], &backup[offset], length));
+      break;
+    default:
+      break;
+  }
+}
+
+static bool needs_backup(const gif_frame_vector* const frame_vector)
+{
+  for (size_t i = 0; i < frame_vector->size; ++i) {
+    const gif_graphic_extension* const extension =
+        &frame_vector->frames[i].graphic_extension;
+    if (extension->packed.disposal_method == GIF_DISPOSAL_PREVIOUS) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Where the composed canvases go and who is told about each finished one.
+ */
+typedef struct decode_output {
+  const gif_details* details;
+  uint8_t* canvases;
+  uint8_t* backup;
+  size_t canvas_bytes;
+  target_layout layout;
+
+  /* If not NULL, then the canvases live in this mapping and each canvas is
+   * handed back to the OS once the canvas after it is done, so only two
+   * canvases stay resident */
+  const spill_mapping* spill;
+
+  const gif_decode_options* options;
+} decode_output;
+
+/**
+ * Starts the canvas of frame \c index from the canvas before it with that
+ * frame disposed of, then saves the area of frame \c index if it is going to
+ * be disposed to the previous state.
+ */
+static uint8_t* prepare_canvas(const decode_output* const output,
+                               const size_t index)
+{
+  const size_t canvas_bytes = output->canvas_bytes;
+  const target_layout* const layout = &output->layout;
+  uint8_t* const canvas = &output->canvases[index * canvas_bytes];
+  const gif_frame_data* const frame =
+      &output->details->frame_vector.frames[index];
+  COUNT_WORK(pixels_written, canvas_bytes / COMPOSE_PIXEL_SIZE);
+  if (index == 0) {
+    memset(canvas, 0, canvas_bytes);
+  } else {
+    memcpy(canvas, &canvas[-canvas_bytes], canvas_bytes);
+    dispose_frame(&frame[-1], canvas, output->backup, layout);
+  }
+
+  if (frame->graphic_extension.packed.disposal_method == GIF_DISPOSAL_PREVIOUS)
+  {
+    uint8_t* const backup = output->backup;
+    FOR_EACH_FRAME_RUN(&frame->descriptor,
+                       layout,
+                       offset,
+                       length,
+                       memcpy(&backup[offset], &canvas[offset], length));
+  }
+
+  return canvas;
+}
+
+static bool is_repeat(const gif_details* const details, const size_t index)
+{
+  const gif_frame_data* const frames = details->frame_vector.frames;
+  return index != 0
+      && is_repeat_of_previous(details, &frames[index - 1], &frames[index]);
+}
+
+static void copy_repeat(const decode_output* const output,
+                        const size_t index,
+                        uint8_t* const canvas)
+{
+  const uint8_t* const previous_canvas = &canvas[-output->canvas_bytes];
+  FOR_EACH_FRAME_RUN(
+      &output->details->frame_vector.frames[index].descriptor,
+      &output->layout,
+      offset,
+      length,
+      memcpy(&canvas[offset], &previous_canvas[offset], length));
+}
+
+/**
+ * Returns the number of tiles with sides of \c tile_size pixels it takes to
+ * cover \c length pixels.
+ */
+static size_t tile_count(const size_t length, const size_t tile_size)
+{
+  return (length + tile_size - 1U) / tile_size;
+}
+
+static size_t dirty_bitmap_size(const gif_descriptor* const descriptor,
+                                const size_t tile_size)
+{
+  const size_t tiles = tile_count(descriptor->canvas_width, tile_size)
+      * tile_count(descriptor->canvas_height, tile_size);
+  return (tiles + 7U) / 8U;
+}
+
+static void mark_dirty_tiles(uint8_t* const bitmap,
+                             const size_t columns,
+                             const size_t tile_size,
+                             const gif_frame_descriptor* const descriptor)
+{
+  const size_t right = (descriptor->left + descriptor->width - 1U) / tile_size;
+  const size_t bottom = (descriptor->top + descriptor->height - 1U) / tile_size;
+  for (size_t row = descriptor->top / tile_size; row <= bottom; ++row) {
+    for (size_t column = descriptor->left / tile_size; column <= right;
+         ++column)
+    {
+      const size_t tile = row * columns + column;
+      bitmap[tile / 8U] |= (uint8_t)(1U << (tile % 8U));
+    }
+  }
+}
+
+/**
+ * Fills the dirty tile bitmap of frame \c index, if it was requested. A
+ * repeated frame leaves the canvas as it was, otherwise the frame itself and
+ * the disposal of the frame before it may change pixels.
+ */
+static void report_dirty_tiles(const decode_output* const output,
+                               const size_t index)
+{
+  const gif_decode_options* const options = output->options;
+  const size_t tile_size = output->layout.tile_size;
+  if (options == NULL || options->dirty_tiles == NULL || tile_size == 0) {
+    return;
+  }
+
+  const gif_details* const details = output->details;
+  const size_t bitmap_size = dirty_bitmap_size(&details->descriptor, tile_size);
+  uint8_t* const bitmap = &options->dirty_tiles[index * bitmap_size];
+  memset(bitmap, 0, bitmap_size);
+
+  const gif_frame_vector* const frame_vector = &details->frame_vector;
+  if (is_repeat(details, index)) {
+    return;
+  }
+
+  const size_t columns =
+      tile_count(details->descriptor.canvas_width, tile_size);
+  const gif_frame_data* const frame = &frame_vector->frames[index];
+  mark_dirty_tiles(bitmap, columns, tile_size, &frame->descriptor);
+  if (index == 0) {
+    return;
+  }
+
+  switch (frame[-1].graphic_extension.packed.disposal_method) {
+    case GIF_DISPOSAL_BACKGROUND:
+    case GIF_DISPOSAL_PREVIOUS:
+      mark_dirty_tiles(bitmap, columns, tile_size, &frame[-1].descriptor);
+      break;
+    default:
+      break;
+  }
+}
+
+static void finish_canvas(const decode_output* const output,
+                          const size_t index,
+                          const uint8_t* const canvas)
+{
+  report_dirty_tiles(output, index);
+
+  const size_t canvas_bytes = output->canvas_bytes;
+  if (output->spill != NULL && index != 0) {
+    spill_release(output->spill, (index - 1) * canvas_bytes, canvas_bytes);
+  }
+
+  const gif_decode_options* const options = output->options;
+  if (options != NULL && options->frame_ready != NULL) {
+    options->frame_ready(options->frame_ready_context, index, canvas);
+  }
+}
+
+/**
+ * Returns where the statistics of frame \c index go, or \c NULL if they were
+ * not requested.
+ */
+static gif_frame_analytics* analytics_result(const decode_output* const output,
+                                             const size_t index)
+{
+  const gif_decode_options* const options = output->options;
+  if (options == NULL || options->analytics == NULL) {
+    return NULL;
+  }
+
+  return &options->analytics[index];
+}
+
+/**
+ * Starts gathering the statistics of frame \c index. Returns \c NULL if they
+ * were not requested.
+ */
+static frame_analytics* begin_analytics(const decode_output* const output,
+                                        const size_t index,
+                                        frame_analytics* const analytics)
+{
+  gif_frame_analytics* const result = analytics_result(output, index);
+  if (result == NULL) {
+    return NULL;
+  }
+
+  const gif_details* const details = output->details;
+  frame_analytics_begin(
+      analytics, result, details, &details->frame_vector.frames[index]);
+  return analytics;
+}
+
+/**
+ * A repeated frame draws the same pixels as the frame before it, so it has
+ * the same statistics as well.
+ */
+static void copy_repeat_analytics(const decode_output* const output,
+                                  const size_t index)
+{
+  gif_frame_analytics* const result = analytics_result(output, index);
+  if (result != NULL) {
+    *result = result[-1];
+  }
+}
+
+static gif_result_code decode_all_frames(const decode_output* const output)
+{
+  const gif_details* const details = output->details;
+  const gif_frame_vector* const frame_vector = &details->frame_vector;
+  for (size_t i = 0; i < frame_vector->size; ++i) {
+    uint8_t* const canvas = prepare_canvas(output, i);
+    if (is_repeat(details, i)) {
+      copy_repeat(output, i, canvas);
+      copy_repeat_analytics(output, i);
+    } else {
+      const gif_decode_target target = {
+          .pixels = canvas,
+          .stride = output->layout.stride,
+          .format = GIF_PIXEL_FORMAT_RGBA8888,
+          .region = GIF_TARGET_CANVAS,
+          .tile_size = (uint16_t)output->layout.tile_size,
+      };
+      frame_analytics storage;
+      frame_analytics* const analytics = begin_analytics(output, i, &storage);
+      TRY(decode_frame(
+          details, &frame_vector->frames[i], &target, analytics));
+      if (analytics != NULL) {
+        frame_analytics_finish(analytics);
+      }
+    }
+
+    finish_canvas(output, i, canvas);
+  }
+
+  return GIF_SUCCESS;
+}
+
+#define PIPELINE_NONE SIZE_MAX
+
+/**
+ * One round of the pipeline: the LZW stream of frame \c decode_index is
+ * decoded into one index buffer of the ring, while frame \c compose_index is
+ * composed from the other.
+ */
+typedef struct pipeline_job {
+  const decode_output* output;
+  uint8_t* ring[2];
+
+  size_t decode_index;
+  gif_result_code decode_code;
+
+  size_t compose_index;
+} pipeline_job;
+
+static gif_result_code decode_indices(const gif_details* const details,
+                                      const gif_frame_data* const frame,
+                                      uint8_t* const indices)
+{
+  lzw_decoder decoder;
+  TRY(lzw_decoder_init(&decoder, details->source, frame));
+
+  const gif_frame_descriptor* const descriptor = &frame->descriptor;
+  const size_t count = (size_t)descriptor->width * descriptor->height;
+  TRY(lzw_decoder_read(&decoder, indices, count));
+
+  return lzw_decoder_finish(&decoder);
+}
+
+static void compose_indices(const decode_output* const output,
+                            const size_t index,
+                            const uint8_t* const indices)
+{
+  const gif_details* const details = output->details;
+  uint8_t* const canvas = prepare_canvas(output, index);
+  if (is_repeat(details, index)) {
+    copy_repeat(output, index, canvas);
+    copy_repeat_analytics(output, index);
+  } else {
+    const gif_frame_data* const frame = &details->frame_vector.frames[index];
+    compose_palette palette;
+    compose_palette_init(
+        &palette, details, frame, GIF_PIXEL_FORMAT_RGBA8888, true);
+
+    frame_analytics storage;
+    frame_analytics* const analytics = begin_analytics(output, index, &storage);
+    const gif_frame_descriptor* const descriptor = &frame->descriptor;
+    const target_view view = {
+        .pixels = canvas,
+        .layout = output->layout,
+        .left = descriptor->left,
+        .top = descriptor->top,
+    };
+    const band_job job = {
+        .descriptor = descriptor,
+        .palette = &palette,
+        .view = &view,
+        .indices = indices,
+        .first_row = 0,
+        .rows = descriptor->height,
+        .part_count = 1,
+        .analytics = analytics,
+    };
+    band_compose(&job, 0);
+    if (analytics != NULL) {
+      frame_analytics_finish(analytics);
+    }
+  }
+
+  finish_canvas(output, index, canvas);
+}
+
+static void pipeline_task(void* const context, const size_t index)
+{
+  pipeline_job* const job = context;
+  if (index == 0) {
+    const size_t decode_index = job->decode_index;
+    if (decode_index != PIPELINE_NONE) {
+      const gif_details* const details = job->output->details;
+      job->decode_code =
+          decode_indices(details,
+                         &details->frame_vector.frames[decode_index],
+                         job->ring[decode_index % 2U]);
+    }
+    return;
+  }
+
+  const size_t compose_index = job->compose_index;
+  if (compose_index != PIPELINE_NONE) {
+    compose_indices(job->output, compose_index, job->ring[compose_index % 2U]);
+  }
+}
+
+/**
+ * Same as ::decode_all_frames, but the LZW stream of each frame is decoded
+ * while the frame before it is being composed. Repeated frames are never
+ * decoded, so their round only composes.
+ */
+static gif_result_code decode_all_frames_pipelined(
+    const decode_output* const output,
+    const gif_executor* const executor,
+    uint8_t* const ring,
+    const size_t ring_slot_bytes)
+{
+  const gif_frame_vector* const frame_vector = &output->details->frame_vector;
+  const size_t count = frame_vector->size;
+  pipeline_job job = {
+      .output = output,
+      .ring = {ring, &ring[ring_slot_bytes]},
+      .decode_code = GIF_SUCCESS,
+  };
+
+  /* A frame is composed in the round after the one it was decoded in, which
+   * is only entered if decoding it succeeded */
+  for (size_t round = 0; round <= count; ++round) {
+    job.decode_index = round < count && !is_repeat(output->details, round)
+        ? round
+        : PIPELINE_NONE;
+    job.compose_index = round != 0 ? round - 1U : PIPELINE_NONE;
+    executor->run(executor->context, &pipeline_task, &job, 2);
+    TRY(job.decode_code);
+  }
+
+  return GIF_SUCCESS;
+}
+
+static const gif_executor* pipeline_executor(
+    const gif_decode_options* const options)
+{
+  if (options == NULL || options->executor == NULL
+      || options->executor->worker_count < 2U)
+  {
+    return NULL;
+  }
+
+  return options->executor;
+}
+
+static size_t max_frame_pixels(const gif_frame_vector* const frame_vector)
+{
+  size_t max_pixels = 0;
+  for (size_t i = 0; i < frame_vector->size; ++i) {
+    const gif_frame_descriptor* const descriptor =
+        &frame_vector->frames[i].descriptor;
+    const size_t pixels = (size_t)descriptor->width * descriptor->height;
+    max_pixels = pixels > max_pixels ? pixels : max_pixels;
+  }
+
+  return max_pixels;
+}
+
+/**
+ * Sizes of the areas of the single block of memory decoding uses: the
+ * canvases, then the backup canvas for frames disposed to the previous state,
+ * then the two index buffers of the pipeline.
+ */
+typedef struct decode_layout {
+  size_t canvas_bytes;
+  size_t output_bytes;
+  size_t backup_bytes;
+  size_t ring_slot_bytes;
+  size_t total_bytes;
+} decode_layout;
+
+static size_t options_tile_size(const gif_decode_options* const options)
+{
+  return options != NULL ? options->tile_size : 0U;
+}
+
+static gif_result_code plan_decode(const gif_details* const details,
+                                   const gif_decode_options* const options,
+                                   decode_layout* const layout)
+{
+  const gif_descriptor* const descriptor = &details->descriptor;
+  uint64_t width = descriptor->canvas_width;
+  uint64_t height = descriptor->canvas_height;
+  const size_t tile_size = options_tile_size(options);
+  if (tile_size != 0) {
+    width = tile_count(descriptor->canvas_width, tile_size) * tile_size;
+    height = tile_count(descriptor->canvas_height, tile_size) * tile_size;
+  }
+
+  const bool is_pipelined = pipeline_executor(options) != NULL;
+  const uint64_t canvas_bytes = width * height * COMPOSE_PIXEL_SIZE;
+  const size_t frame_count = details->frame_vector.size;
+  if (frame_count == 0 || canvas_bytes == 0) {
+    return GIF_FRAME_DATA_EMPTY;
+  }
+
+  const gif_limits* const limits = &details->limits;
+  if (canvas_bytes > SIZE_MAX || frame_count > SIZE_MAX / canvas_bytes) {
+    return GIF_ALLOC_FAIL;
+  }
+
+  const size_t output_bytes = (size_t)canvas_bytes * frame_count;
+  if (limits->max_total_decoded_bytes != 0
+      && output_bytes > limits->max_total_decoded_bytes)
+  {
+    return GIF_DECODED_SIZE_LIMIT_EXCEEDED;
+  }
+
+  const size_t backup_bytes =
+      needs_backup(&details->frame_vector) ? (size_t)canvas_bytes : 0;
+  /* Frames lie within the canvas, so the ring is at most half a canvas */
+  const size_t ring_slot_bytes =
+      is_pipelined ? max_frame_pixels(&details->frame_vector) : 0;
+  const size_t extra_bytes = backup_bytes + ring_slot_bytes * 2U;
+  if (extra_bytes > SIZE_MAX - output_bytes) {
+    return GIF_ALLOC_FAIL;
+  }
+
+  *layout = (decode_layout) {
+      .canvas_bytes = (size_t)canvas_bytes,
+      .output_bytes = output_bytes,
+      .backup_bytes = backup_bytes,
+      .ring_slot_bytes = ring_slot_bytes,
+      .total_bytes = output_bytes + extra_bytes,
+  };
+  return GIF_SUCCESS;
+}
+
+static gif_result_code decode_into(uint8_t* const memory,
+                                   const gif_details* const details,
+                                   const decode_layout* const layout,
+                                   const gif_decode_options* const options,
+                                   const spill_mapping* const spill)
+{
+  const size_t canvas_width = details->descriptor.canvas_width;
+  decode_output output = {
+      .details = details,
+      .canvases = memory,
+      .backup = &memory[layout->output_bytes],
+      .canvas_bytes = layout->canvas_bytes,
+      .spill = spill,
+      .options = options,
+  };
+  target_layout_init(&output.layout,
+                     canvas_width * COMPOSE_PIXEL_SIZE,
+                     options_tile_size(options),
+                     canvas_width);
+
+  const gif_executor* const executor = pipeline_executor(options);
+  if (executor == NULL) {
+    return decode_all_frames(&output);
+  }
+
+  return decode_all_frames_pipelined(
+      &output,
+      executor,
+      &memory[layout->output_bytes + layout->backup_bytes],
+      layout->ring_slot_bytes);
+}
+
+static gif_result_code decode_to_heap(void** const data,
+                                      const gif_details* const details,
+                                      const decode_layout* const layout,
+                                      const gif_allocator allocator,
+                                      const gif_decode_options* const options)
+{
+  const size_t max_memory = details->limits.max_memory;
+  if (max_memory != 0 && layout->total_bytes > max_memory) {
+    return GIF_MEMORY_LIMIT_EXCEEDED;
+  }
+
+  /* The scratch areas are placed after the frames, so the caller only ever
+   * has one allocation to free, even when decoding fails */
+  uint8_t* output = allocator(NULL, layout->total_bytes);
+  if (output == NULL) {
+    return GIF_ALLOC_FAIL;
+  }
+
+  *data = output;
+  TRY(decode_into(output, details, layout, options, NULL));
+
+  if (layout->total_bytes != layout->output_bytes) {
+    /* Failing to shrink the allocation is harmless */
+    uint8_t* const shrunk = allocator(output, layout->output_bytes);
+    if (shrunk != NULL) {
+      output = shrunk;
+    }
+  }
+
+  *data = output;
+  return GIF_SUCCESS;
+}
+
 gif_result_code gif_decode_impl(void** const data,
                                 gif_details* const details,
                                 const gif_allocator allocator)
 {
-  (void)data;
-  (void)details;
-  (void)allocator;
+  decode_layout layout;
+  TRY(plan_decode(details, NULL, &layout));
+
+  return decode_to_heap(data, details, &layout, allocator, NULL);
+}
+
+gif_result_code gif_decode_reusing_impl(uint8_t** const buffer,
+                                        size_t* const capacity,
+                                        const gif_details* const details,
+                                        const gif_allocator allocator,
+                                        const gif_deallocator deallocator)
+{
+  decode_layout layout;
+  TRY(plan_decode(details, NULL, &layout));
+
+  const size_t max_memory = details->limits.max_memory;
+  if (max_memory != 0 && layout.total_bytes > max_memory) {
+    return GIF_MEMORY_LIMIT_EXCEEDED;
+  }
+
+  if (*capacity < layout.total_bytes) {
+    /* The old contents are overwritten anyway, so they are not copied */
+    deallocator(*buffer);
+    *capacity = 0;
+    *buffer = allocator(NULL, layout.total_bytes);
+    if (*buffer == NULL) {
+      return GIF_ALLOC_FAIL;
+    }
+
+    *capacity = layout.total_bytes;
+  }
+
+  return decode_into(*buffer, details, &layout, NULL, NULL);
+}
+
+gif_result_code gif_decode_to_store_impl(
+    gif_frame_store* const store,
+    const gif_details* const details,
+    const gif_allocator allocator,
+    const gif_decode_options* const options)
+{
+  decode_layout layout;
+  TRY(plan_decode(details, options, &layout));
+
+  store->canvas_size = layout.canvas_bytes;
+  store->size = details->frame_vector.size;
+
+  if (options == NULL || options->spill_threshold == 0
+      || layout.total_bytes <= options->spill_threshold)
+  {
+    void* data = NULL;
+    const gif_result_code code =
+        decode_to_heap(&data, details, &layout, allocator, options);
+    store->canvases = data;
+    return code;
+  }
+
+  /* The mapping is not allocated through the allocator, so it does not count
+   * towards the memory limit */
+  spill_mapping mapping;
+  TRY(spill_map(&mapping, layout.total_bytes, options->spill_directory));
+
+  store->canvases = mapping.pointer;
+  store->spilled = true;
+  store->allocation_size = mapping.size;
+  memcpy(store->cleanup_data,
+         mapping.cleanup_data,
+         sizeof(mapping.cleanup_data));
+
+  return decode_into(mapping.pointer, details, &layout, options, &mapping);
+}
+
+void gif_frame_store_free_impl(const gif_frame_store* const store,
+                               const gif_deallocator deallocator)
+{
+  if (!store->spilled) {
+    deallocator(store->canvases);
+    return;
+  }
+
+  spill_mapping mapping = {
+      .pointer = store->canvases,
+      .size = store->allocation_size,
+  };
+  memcpy(mapping.cleanup_data,
+         store->cleanup_data,
+         sizeof(mapping.cleanup_data));
+  spill_unmap(&mapping);
+}
+
+size_t gif_dirty_tiles_size_impl(const gif_details* const details,
+                                 const size_t tile_size)
+{
+  return details->frame_vector.size
+      * dirty_bitmap_size(&details->descriptor, tile_size);
+}
+
+/**
+ * Expands the color table of \c frame to all 256 indices, with black past its
+ * end like ::compose_palette_init_table does.
+ */
+static void expand_color_table(uint32_t* const palette,
+                               const gif_details* const details,
+                               const gif_frame_data* const frame)
+{
+  size_t color_count;
+  const uint32_t* const color_table =
+      compose_color_table(details, frame, &color_count);
+  if (color_count != 0) {
+    memcpy(palette, color_table, color_count * sizeof(uint32_t));
+  }
+
+  memset(&palette[color_count],
+         0,
+         (COMPOSE_PALETTE_SIZE - color_count) * sizeof(uint32_t));
+}
+
+/**
+ * Checks that every frame is drawn with the same colors and picks the index
+ * that stands for transparent pixels.
+ */
+static gif_result_code find_shared_palette(const gif_details* const details,
+                                           gif_indexed_frames* const frames)
+{
+  const gif_frame_vector* const frame_vector = &details->frame_vector;
+  expand_color_table(frames->palette, details, &frame_vector->frames[0]);
+
+  uint32_t palette[COMPOSE_PALETTE_SIZE];
+  for (size_t i = 1; i < frame_vector->size; ++i) {
+    const gif_frame_data* const frame = &frame_vector->frames[i];
+    if (!frame->descriptor.packed.local_color_table_flag
+        && !frame_vector->frames[0].descriptor.packed.local_color_table_flag)
+    {
+      continue;
+    }
+
+    expand_color_table(palette, details, frame);
+    if (memcmp(palette, frames->palette, sizeof(palette)) != 0) {
+      return GIF_INDEXED_UNSUPPORTED;
+    }
+  }
+
+  for (size_t i = 0; i < frame_vector->size; ++i) {
+    const gif_graphic_extension* const extension =
+        &frame_vector->frames[i].graphic_extension;
+    if (extension->packed.transparent_color_flag) {
+      frames->transparent_index = extension->transparent_color_index;
+      return GIF_SUCCESS;
+    }
+  }
+
+  size_t color_count;
+  compose_color_table(details, &frame_vector->frames[0], &color_count);
+  frames->transparent_index = color_count < COMPOSE_PALETTE_SIZE
+      ? (uint8_t)color_count
+      : (uint8_t)(COMPOSE_PALETTE_SIZE - 1U);
+  return GIF_SUCCESS;
+}
+
+/**
+ * Writes the \c count indices of a span of \c frame to \c destination,
+ * skipping its transparent pixels. Returns \c false if an opaque pixel uses
+ * \c transparent_index, which the canvases cannot represent.
+ */
+static bool write_indexed_span(uint8_t* const destination,
+                               const uint8_t* const indices,
+                               const size_t count,
+                               const gif_frame_data* const frame,
+                               const uint8_t transparent_index)
+{
+  COUNT_WORK(pixels_written, count);
+  const gif_graphic_extension* const extension = &frame->graphic_extension;
+  if (!extension->packed.transparent_color_flag) {
+    if (memchr(indices, transparent_index, count) != NULL) {
+      return false;
+    }
+
+    memcpy(destination, indices, count);
+    return true;
+  }
+
+  const uint8_t skipped_index = extension->transparent_color_index;
+  for (size_t i = 0; i < count; ++i) {
+    const uint8_t index = indices[i];
+    if (index == skipped_index) {
+      continue;
+    }
+
+    if (index == transparent_index) {
+      return false;
+    }
+
+    destination[i] = index;
+  }
+
+  return true;
+}
+
+static gif_result_code decode_indexed_frame(const gif_details* const details,
+                                            const gif_frame_data* const frame,
+                                            uint8_t* const canvas,
+                                            const uint8_t transparent_index)
+{
+  lzw_decoder decoder;
+  TRY(lzw_decoder_init(&decoder, details->source, frame));
+
+  const gif_frame_descriptor* const descriptor = &frame->descriptor;
+  const size_t width = descriptor->width;
+  const size_t height = descriptor->height;
+  const size_t stride = details->descriptor.canvas_width;
+  uint8_t* const origin = &canvas[descriptor->top * stride + descriptor->left];
+
+  uint8_t indices[DECODE_CHUNK_SIZE];
+  const bool is_interlaced = descriptor->packed.interlace_flag;
+  for (size_t row = 0; row < height; ++row) {
+    const size_t y = is_interlaced ? interlaced_row(row, height) : row;
+    for (size_t x = 0; x < width; x += DECODE_CHUNK_SIZE) {
+      const size_t left = width - x;
+      const size_t count = left < DECODE_CHUNK_SIZE ? left : DECODE_CHUNK_SIZE;
+      TRY(lzw_decoder_read(&decoder, indices, count));
+      uint8_t* const destination = &origin[y * stride + x];
+      if (!write_indexed_span(
+              destination, indices, count, frame, transparent_index))
+      {
+        return GIF_INDEXED_UNSUPPORTED;
+      }
+    }
+  }
+
+  return lzw_decoder_finish(&decoder);
+}
+
+/**
+ * Calls \c operation on the offset of each row of the frame's rectangle in an
+ * indexed canvas.
+ */
+#define FOR_EACH_INDEXED_ROW(descriptor, stride, row, operation) \
+  do { \
+    for (size_t y_ = 0; y_ < (descriptor)->height; ++y_) { \
+      const size_t row = ((descriptor)->top + y_) * (stride) \
+          + (descriptor)->left; \
+      operation; \
+    } \
+  } while (0)
+
+/**
+ * Same as ::decode_all_frames, but with a byte per pixel. Disposing to the
+ * background writes the transparent index.
+ */
+static gif_result_code decode_all_indexed(
+    const gif_details* const details,
+    const gif_indexed_frames* const frames,
+    uint8_t* const backup)
+{
+  const gif_frame_vector* const frame_vector = &details->frame_vector;
+  const size_t canvas_size = frames->canvas_size;
+  const size_t stride = frames->canvas_width;
+  const uint8_t transparent_index = frames->transparent_index;
+  for (size_t i = 0; i < frame_vector->size; ++i) {
+    const gif_frame_data* const frame = &frame_vector->frames[i];
+    uint8_t* const canvas = &frames->indices[i * canvas_size];
+    COUNT_WORK(pixels_written, canvas_size);
+    if (i == 0) {
+      memset(canvas, transparent_index, canvas_size);
+    } else {
+      memcpy(canvas, &canvas[-canvas_size], canvas_size);
+      const gif_frame_descriptor* const previous = &frame[-1].descriptor;
+      switch (frame[-1].graphic_extension.packed.disposal_method) {
+        case GIF_DISPOSAL_BACKGROUND:
+          FOR_EACH_INDEXED_ROW(
+              previous,
+              stride,
+              row,
+              memset(&canvas[row], transparent_index, previous->width));
+          break;
+        case GIF_DISPOSAL_PREVIOUS:
+          FOR_EACH_INDEXED_ROW(
+              previous,
+              stride,
+              row,
+              memcpy(&canvas[row], &backup[row], previous->width));
+          break;
+        default:
+          break;
+      }
+    }
+
+    const gif_frame_descriptor* const descriptor = &frame->descriptor;
+    if (frame->graphic_extension.packed.disposal_method
+        == GIF_DISPOSAL_PREVIOUS)
+    {
+      FOR_EACH_INDEXED_ROW(
+          descriptor,
+          stride,
+          row,
+          memcpy(&backup[row], &canvas[row], descriptor->width));
+    }
+
+    if (is_repeat(details, i)) {
+      const uint8_t* const previous_canvas = &canvas[-canvas_size];
+      FOR_EACH_INDEXED_ROW(
+          descriptor,
+          stride,
+          row,
+          memcpy(&canvas[row], &previous_canvas[row], descriptor->width));
+    } else {
+      TRY(decode_indexed_frame(details, frame, canvas, transparent_index));
+    }
+  }
+
+  return GIF_SUCCESS;
+}
+
+gif_result_code gif_decode_indexed_impl(gif_indexed_frames* const frames,
+                                        const gif_details* const details,
+                                        const gif_allocator allocator)
+{
+  const gif_descriptor* const descriptor = &details->descriptor;
+  const uint64_t canvas_size =
+      (uint64_t)descriptor->canvas_width * descriptor->canvas_height;
+  const size_t frame_count = details->frame_vector.size;
+  if (frame_count == 0 || canvas_size == 0) {
+    return GIF_FRAME_DATA_EMPTY;
+  }
+
+  if (canvas_size > SIZE_MAX || frame_count > SIZE_MAX / canvas_size) {
+    return GIF_ALLOC_FAIL;
+  }
+
+  /* The limit is stated in terms of expanded canvases */
+  const gif_limits* const limits = &details->limits;
+  const size_t output_bytes = (size_t)canvas_size * frame_count;
+  if (limits->max_total_decoded_bytes != 0
+      && output_bytes > limits->max_total_decoded_bytes / COMPOSE_PIXEL_SIZE)
+  {
+    return GIF_DECODED_SIZE_LIMIT_EXCEEDED;
+  }
+
+  const size_t backup_bytes =
+      needs_backup(&details->frame_vector) ? (size_t)canvas_size : 0;
+  if (backup_bytes > SIZE_MAX - output_bytes) {
+    return GIF_ALLOC_FAIL;
+  }
+
+  const size_t total_bytes = output_bytes + backup_bytes;
+  if (limits->max_memory != 0 && total_bytes > limits->max_memory) {
+    return GIF_MEMORY_LIMIT_EXCEEDED;
+  }
+
+  frames->canvas_size = (size_t)canvas_size;
+  frames->size = frame_count;
+  frames->canvas_width = descriptor->canvas_width;
+  frames->canvas_height = descriptor->canvas_height;
+  TRY(find_shared_palette(details, frames));
+
+  /* The backup canvas is placed after the frames, so the caller only ever has
+   * one allocation to free, even when decoding fails */
+  frames->indices = allocator(NULL, total_bytes);
+  if (frames->indices == NULL) {
+    return GIF_ALLOC_FAIL;
+  }
+
+  TRY(decode_all_indexed(details, frames, &frames->indices[output_bytes]));
+
+  if (backup_bytes != 0) {
+    /* Failing to shrink the allocation is harmless */
+    uint8_t* const shrunk = allocator(frames->indices, output_bytes);
+    if (shrunk != NULL) {
+      frames->indices = shrunk;
+    }
+  }
+
+  return GIF_SUCCESS;
+}
+
+gif_result_code gif_indexed_frame_expand_impl(
+    const gif_indexed_frames* const frames,
+    const size_t index,
+    const gif_decode_target* const target)
+{
+  if (index >= frames->size) {
+    return GIF_FRAME_INDEX_OUT_OF_RANGE;
+  }
+
+  const size_t width = frames->canvas_width;
+  const bool is_format_valid = target->format == GIF_PIXEL_FORMAT_RGBA8888
+      || target->format == GIF_PIXEL_FORMAT_BGRA8888;
+  if (target->pixels == NULL || target->region != GIF_TARGET_CANVAS
+      || target->tile_size != 0 || !is_format_valid
+      || target->stride < width * COMPOSE_PIXEL_SIZE)
+  {
+    return GIF_INVALID_DECODE_TARGET;
+  }
+
+  compose_palette palette;
+  compose_palette_init_table(
+      &palette, frames->palette, COMPOSE_PALETTE_SIZE, target->format);
+  palette.colors[frames->transparent_index] = 0;
+
+  const uint8_t* const canvas = &frames->indices[index * frames->canvas_size];
+  uint8_t* const pixels = target->pixels;
+  for (size_t y = 0; y < frames->canvas_height; ++y) {
+    compose_span(
+        &pixels[y * target->stride], &canvas[y * width], width, &palette);
+  }
 
   return GIF_SUCCESS;
 }
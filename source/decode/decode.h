@@ -2,6 +2,62 @@
 
 #include "gif_engine/gif_engine.h"
 
+/**
+ * Decodes a single frame into the caller owned \c target after validating the
+ * arguments. See ::gif_decode_frame for details.
+ */
+gif_result_code gif_decode_frame_impl(const gif_details* details,
+                                      size_t frame_index,
+                                      const gif_decode_target* target);
+
+/**
+ * Same as ::gif_decode_frame_impl, but the frame is composed in bands by the
+ * workers of \c executor. See ::gif_decode_frame_parallel for details.
+ */
+gif_result_code gif_decode_frame_parallel_impl(
+    const gif_details* details,
+    size_t frame_index,
+    const gif_decode_target* target,
+    const gif_executor* executor,
+    gif_allocator allocator,
+    gif_deallocator deallocator);
+
 gif_result_code gif_decode_impl(void** data,
                                 gif_details* details,
                                 gif_allocator allocator);
+
+/**
+ * Same as ::gif_decode_impl, but the canvases are decoded into \c buffer,
+ * which is only reallocated if its \c capacity is too small.
+ */
+gif_result_code gif_decode_reusing_impl(uint8_t** buffer,
+                                        size_t* capacity,
+                                        const gif_details* details,
+                                        gif_allocator allocator,
+                                        gif_deallocator deallocator);
+
+/**
+ * Same as ::gif_decode_impl, but the output may be spilled to a temporary file
+ * depending on \c options. See ::gif_decode_to_store for details.
+ */
+gif_result_code gif_decode_to_store_impl(gif_frame_store* store,
+                                         const gif_details* details,
+                                         gif_allocator allocator,
+                                         const gif_decode_options* options);
+
+void gif_frame_store_free_impl(const gif_frame_store* store,
+                               gif_deallocator deallocator);
+
+size_t gif_dirty_tiles_size_impl(const gif_details* details, size_t tile_size);
+
+/**
+ * Same as ::gif_decode_impl, but the canvases are kept as palette indices.
+ * See ::gif_decode_indexed for details.
+ */
+gif_result_code gif_decode_indexed_impl(gif_indexed_frames* frames,
+                                        const gif_details* details,
+                                        gif_allocator allocator);
+
+gif_result_code gif_indexed_frame_expand_impl(const gif_indexed_frames* frames,
+                                              size_t index,
+                                              const gif_decode_target* target);
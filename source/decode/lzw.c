@@ -0,0 +1,517 @@
+#include "decode/lzw.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "work.h"
+
+#define LZW_MIN_CODE_SIZE_LOW 2U
+#define LZW_MIN_CODE_SIZE_HIGH 8U
+/* The loops below are written once and stamped out for every minimum code
+ * size, so they must be inlined into the stamped out functions for the
+ * constants derived from the minimum code size to be folded in */
+#if defined(_MSC_VER)
+#  define LZW_INLINE static __forceinline
+#elif defined(__GNUC__)
+#  define LZW_INLINE static inline __attribute__((always_inline))
+#else
+#  define LZW_INLINE static inline
+#endif
+
+static void lzw_reader_init(lzw_reader* const reader,
+                            const gif_source* const source,
+                            const gif_frame_data* const frame,
+                            uint8_t* const window)
+{
+  reader->data_remaining = frame->data_length;
+  reader->source = source;
+  reader->window = window;
+  reader->read_failed = false;
+  reader->bits = 0;
+  reader->bit_count = 0;
+
+  if (source == NULL) {
+    /* first_subblock points past the length byte of the first sub-block */
+    reader->current = frame->first_subblock;
+    reader->subblock_remaining = frame->first_subblock[-1];
+    reader->window_end = NULL;
+    return;
+  }
+
+  /* Start with an empty window at the length byte of the first sub-block */
+  reader->current = window;
+  reader->subblock_remaining = 0;
+  reader->window_end = window;
+  reader->next_offset = frame->data_offset - 1U;
+}
+
+static void lzw_reader_fetch(lzw_reader* const reader)
+{
+  const gif_source* const source = reader->source;
+  size_t size = LZW_READAHEAD_SIZE;
+  if (!reader->read_failed) {
+    const uint64_t file_left = source->size > reader->next_offset
+        ? source->size - reader->next_offset
+        : 0;
+    if (size > file_left) {
+      size = (size_t)file_left;
+    }
+
+    reader->read_failed = size == 0
+        || !source->read(
+            source->context, reader->next_offset, reader->window, size);
+  }
+
+  if (reader->read_failed) {
+    size = LZW_READAHEAD_SIZE;
+    memset(reader->window, 0, size);
+  }
+
+  reader->current = reader->window;
+  reader->window_end = reader->window + size;
+  reader->next_offset += size;
+}
+
+static uint8_t lzw_reader_take(lzw_reader* const reader)
+{
+  if (reader->current == reader->window_end) {
+    lzw_reader_fetch(reader);
+  }
+
+  const uint8_t byte = *reader->current;
+  ++reader->current;
+  return byte;
+}
+
+/**
+ * Tops up the bit buffer to at least 24 bits, or as much as the data allows.
+ * Codes are at most 12 bits wide, so this runs at most once every other code.
+ */
+static void lzw_reader_refill(lzw_reader* const reader)
+{
+  while (reader->bit_count <= 24U && reader->data_remaining != 0) {
+    if (reader->subblock_remaining == 0) {
+      reader->subblock_remaining = lzw_reader_take(reader);
+    }
+
+    reader->bits |= (uint32_t)lzw_reader_take(reader) << reader->bit_count;
+    --reader->subblock_remaining;
+    --reader->data_remaining;
+    reader->bit_count += 8U;
+  }
+}
+
+LZW_INLINE bool lzw_reader_next(lzw_reader* const reader,
+                                const uint8_t width,
+                                const uint16_t mask,
+                                uint16_t* const code)
+{
+  if (reader->bit_count < width) {
+    lzw_reader_refill(reader);
+    if (reader->bit_count < width) {
+      return false;
+    }
+  }
+
+  COUNT_WORK(lzw_codes, 1U);
+  *code = (uint16_t)(reader->bits & mask);
+  reader->bits >>= width;
+  reader->bit_count -= width;
+  return true;
+}
+
+LZW_INLINE gif_result_code lzw_verify_generic(lzw_reader* const reader,
+                                              const gif_frame_data* const frame,
+                                              size_t* const pixel_count,
+                                              const uint8_t min_code_size)
+{
+  const size_t expected =
+      (size_t)frame->descriptor.width * frame->descriptor.height;
+  const uint16_t clear_code = (uint16_t)(1U << min_code_size);
+  const uint16_t end_code = clear_code + 1U;
+  const uint8_t first_width = min_code_size + 1U;
+
+  /* Literal codes are never written to, so only those need initialization */
+  uint16_t lengths[LZW_TABLE_SIZE];
+  for (uint16_t i = 0; i < clear_code; ++i) {
+    lengths[i] = 1;
+  }
+
+  /* The code width only changes when next_code reaches width_limit, which is
+   * also one past the mask for the current width */
+  uint8_t width = first_width;
+  uint16_t width_limit = (uint16_t)(1U << first_width);
+  uint16_t next_code = end_code + 1U;
+  uint16_t previous_code = 0;
+  bool has_previous = false;
+  size_t count = 0;
+  gif_result_code code = GIF_SUCCESS;
+
+  uint16_t current_code;
+  while (lzw_reader_next(
+      reader, width, (uint16_t)(width_limit - 1U), &current_code))
+  {
+    if (current_code == clear_code) {
+      width = first_width;
+      width_limit = (uint16_t)(1U << first_width);
+      next_code = end_code + 1U;
+      has_previous = false;
+      continue;
+    }
+
+    if (current_code == end_code) {
+      break;
+    }
+
+    uint16_t length;
+    if (!has_previous) {
+      if (current_code >= clear_code) {
+        code = GIF_LZW_INVALID_CODE;
+        break;
+      }
+
+      length = 1;
+    } else {
+      if (current_code > next_code) {
+        code = GIF_LZW_INVALID_CODE;
+        break;
+      }
+
+      const uint16_t previous_length = lengths[previous_code];
+      length = current_code == next_code ? previous_length + 1U
+                                         : lengths[current_code];
+
+      if (next_code < LZW_TABLE_SIZE) {
+        lengths[next_code] = previous_length + 1U;
+        ++next_code;
+        if (next_code == width_limit && width < LZW_MAX_CODE_WIDTH) {
+          ++width;
+          width_limit = (uint16_t)(width_limit << 1U);
+        }
+      }
+    }
+
+    count += length;
+    if (count > expected) {
+      code = GIF_LZW_OUTPUT_OVERFLOW;
+      break;
+    }
+
+    previous_code = current_code;
+    has_previous = true;
+  }
+
+  if (code == GIF_SUCCESS && count < expected) {
+    code = GIF_LZW_EARLY_END;
+  }
+
+  *pixel_count = count;
+  return code;
+}
+
+/**
+ * Writes the string belonging to \c code to \c destination back to front by
+ * following the prefix chain of the code.
+ */
+static void lzw_write_string(const lzw_decoder* const decoder,
+                             uint16_t code,
+                             const uint16_t length,
+                             uint8_t* const destination)
+{
+  for (uint16_t i = length; i != 0;) {
+    --i;
+    destination[i] = decoder->suffix[code];
+    code = decoder->prefix[code];
+  }
+}
+
+LZW_INLINE gif_result_code lzw_read_generic(lzw_decoder* const decoder,
+                                            uint8_t* const destination,
+                                            const size_t count,
+                                            const uint8_t min_code_size)
+{
+  assert(count <= decoder->remaining);
+
+  const uint16_t clear_code = (uint16_t)(1U << min_code_size);
+  const uint16_t end_code = clear_code + 1U;
+  const uint8_t first_width = min_code_size + 1U;
+
+  size_t position = 0;
+  if (decoder->pending_size != 0) {
+    const size_t pending_size = decoder->pending_size;
+    position = count < pending_size ? count : pending_size;
+    memcpy(destination,
+           &decoder->pending[decoder->pending_offset],
+           position);
+    decoder->pending_offset = (uint16_t)(decoder->pending_offset + position);
+    decoder->pending_size = (uint16_t)(pending_size - position);
+  }
+
+  lzw_reader reader = decoder->reader;
+  uint8_t width = decoder->width;
+  uint16_t width_limit = decoder->width_limit;
+  uint16_t next_code = decoder->next_code;
+  uint16_t previous_code = decoder->previous_code;
+  uint8_t previous_first = decoder->previous_first;
+  bool has_previous = decoder->has_previous;
+  gif_result_code code = GIF_SUCCESS;
+
+  while (position < count) {
+    uint16_t current_code;
+    if (!lzw_reader_next(
+            &reader, width, (uint16_t)(width_limit - 1U), &current_code))
+    {
+      code = GIF_LZW_EARLY_END;
+      break;
+    }
+
+    if (current_code == clear_code) {
+      width = first_width;
+      width_limit = (uint16_t)(1U << first_width);
+      next_code = end_code + 1U;
+      has_previous = false;
+      continue;
+    }
+
+    if (current_code == end_code) {
+      code = GIF_LZW_EARLY_END;
+      break;
+    }
+
+    if (!has_previous) {
+      if (current_code >= clear_code) {
+        code = GIF_LZW_INVALID_CODE;
+        break;
+      }
+
+      destination[position] = (uint8_t)current_code;
+      ++position;
+      previous_code = current_code;
+      previous_first = (uint8_t)current_code;
+      has_previous = true;
+      continue;
+    }
+
+    if (current_code > next_code) {
+      code = GIF_LZW_INVALID_CODE;
+      break;
+    }
+
+    /* The code not in the table yet can only be the previous string followed
+     * by its own first byte, so its entry must be added before writing it */
+    const bool is_new_code = current_code == next_code;
+    if (is_new_code) {
+      decoder->prefix[next_code] = previous_code;
+      decoder->suffix[next_code] = previous_first;
+      decoder->lengths[next_code] =
+          (uint16_t)(decoder->lengths[previous_code] + 1U);
+    }
+
+    const uint16_t length = decoder->lengths[current_code];
+    if (length > decoder->remaining - position) {
+      code = GIF_LZW_OUTPUT_OVERFLOW;
+      break;
+    }
+
+    uint8_t first;
+    if (length <= count - position) {
+      lzw_write_string(
+          decoder, current_code, length, &destination[position]);
+      first = destination[position];
+      position += length;
+    } else {
+      lzw_write_string(decoder, current_code, length, decoder->pending);
+      first = decoder->pending[0];
+      const size_t fitting = count - position;
+      memcpy(&destination[position], decoder->pending, fitting);
+      decoder->pending_offset = (uint16_t)fitting;
+      decoder->pending_size = (uint16_t)(length - fitting);
+      position = count;
+    }
+
+    if (next_code < LZW_TABLE_SIZE) {
+      if (!is_new_code) {
+        decoder->prefix[next_code] = previous_code;
+        decoder->suffix[next_code] = first;
+        decoder->lengths[next_code] =
+            (uint16_t)(decoder->lengths[previous_code] + 1U);
+      }
+
+      ++next_code;
+      if (next_code == width_limit && width < LZW_MAX_CODE_WIDTH) {
+        ++width;
+        width_limit = (uint16_t)(width_limit << 1U);
+      }
+    }
+
+    previous_code = current_code;
+    previous_first = first;
+  }
+
+  decoder->reader = reader;
+  decoder->width = width;
+  decoder->width_limit = width_limit;
+  decoder->next_code = next_code;
+  decoder->previous_code = previous_code;
+  decoder->previous_first = previous_first;
+  decoder->has_previous = has_previous;
+  decoder->remaining -= position;
+  return code;
+}
+
+typedef gif_result_code (*lzw_verify_function)(lzw_reader* reader,
+                                               const gif_frame_data* frame,
+                                               size_t* pixel_count);
+
+#define LZW_SPECIALIZE(size) \
+  static gif_result_code lzw_verify_##size(lzw_reader* const reader, \
+                                           const gif_frame_data* const frame, \
+                                           size_t* const pixel_count) \
+  { \
+    return lzw_verify_generic(reader, frame, pixel_count, size##U); \
+  } \
+\
+  static gif_result_code lzw_read_##size(lzw_decoder* const decoder, \
+                                         uint8_t* const destination, \
+                                         const size_t count) \
+  { \
+    return lzw_read_generic(decoder, destination, count, size##U); \
+  }
+
+LZW_SPECIALIZE(2)
+LZW_SPECIALIZE(3)
+LZW_SPECIALIZE(4)
+LZW_SPECIALIZE(5)
+LZW_SPECIALIZE(6)
+LZW_SPECIALIZE(7)
+LZW_SPECIALIZE(8)
+
+#undef LZW_SPECIALIZE
+
+static const lzw_verify_function lzw_verify_functions[] = {
+    &lzw_verify_2,
+    &lzw_verify_3,
+    &lzw_verify_4,
+    &lzw_verify_5,
+    &lzw_verify_6,
+    &lzw_verify_7,
+    &lzw_verify_8,
+};
+
+static const lzw_read_function lzw_read_functions[] = {
+    &lzw_read_2,
+    &lzw_read_3,
+    &lzw_read_4,
+    &lzw_read_5,
+    &lzw_read_6,
+    &lzw_read_7,
+    &lzw_read_8,
+};
+
+#define LZW_SPECIALIZATION_COUNT \
+  (LZW_MIN_CODE_SIZE_HIGH - LZW_MIN_CODE_SIZE_LOW + 1U)
+
+_Static_assert(sizeof(lzw_verify_functions) / sizeof(lzw_verify_function)
+                       == LZW_SPECIALIZATION_COUNT
+                   && sizeof(lzw_read_functions) / sizeof(lzw_read_function)
+                       == LZW_SPECIALIZATION_COUNT,
+               "There must be a specialization for every minimum code size");
+
+static bool is_min_code_size_invalid(const uint8_t min_code_size)
+{
+  return min_code_size < LZW_MIN_CODE_SIZE_LOW
+      || LZW_MIN_CODE_SIZE_HIGH < min_code_size;
+}
+
+gif_result_code lzw_verify(const gif_source* const source,
+                           const gif_frame_data* const frame,
+                           size_t* const pixel_count)
+{
+  *pixel_count = 0;
+
+  const uint8_t min_code_size = frame->min_code_size;
+  if (is_min_code_size_invalid(min_code_size)) {
+    return GIF_LZW_INVALID_MIN_CODE_SIZE;
+  }
+
+  uint8_t window[LZW_READAHEAD_SIZE];
+  lzw_reader reader;
+  lzw_reader_init(&reader, source, frame, window);
+
+  const gif_result_code code =
+      lzw_verify_functions[min_code_size - LZW_MIN_CODE_SIZE_LOW](
+          &reader, frame, pixel_count);
+  return reader.read_failed ? GIF_SOURCE_READ_FAIL : code;
+}
+
+gif_result_code lzw_decoder_init(lzw_decoder* const decoder,
+                                 const gif_source* const source,
+                                 const gif_frame_data* const frame)
+{
+  const uint8_t min_code_size = frame->min_code_size;
+  if (is_min_code_size_invalid(min_code_size)) {
+    return GIF_LZW_INVALID_MIN_CODE_SIZE;
+  }
+
+  lzw_reader_init(&decoder->reader, source, frame, decoder->readahead);
+  decoder->read = lzw_read_functions[min_code_size - LZW_MIN_CODE_SIZE_LOW];
+  decoder->remaining =
+      (size_t)frame->descriptor.width * frame->descriptor.height;
+
+  const uint16_t clear_code = (uint16_t)(1U << min_code_size);
+  decoder->min_code_size = min_code_size;
+  decoder->width = min_code_size + 1U;
+  decoder->width_limit = (uint16_t)(clear_code << 1U);
+  decoder->next_code = clear_code + 2U;
+  decoder->previous_code = 0;
+  decoder->previous_first = 0;
+  decoder->has_previous = false;
+  decoder->pending_offset = 0;
+  decoder->pending_size = 0;
+
+  for (uint16_t i = 0; i < clear_code; ++i) {
+    decoder->suffix[i] = (uint8_t)i;
+    decoder->lengths[i] = 1;
+  }
+
+  return GIF_SUCCESS;
+}
+
+gif_result_code lzw_decoder_finish(lzw_decoder* const decoder)
+{
+  if (decoder->pending_size != 0) {
+    return GIF_LZW_OUTPUT_OVERFLOW;
+  }
+
+  /* Only clear codes may come between the last pixel and the end of the
+   * stream, anything else would produce more pixels or is invalid */
+  const uint16_t clear_code = (uint16_t)(1U << decoder->min_code_size);
+  const uint16_t end_code = clear_code + 1U;
+  uint16_t code;
+  while (lzw_reader_next(&decoder->reader,
+                         decoder->width,
+                         (uint16_t)(decoder->width_limit - 1U),
+                         &code))
+  {
+    if (code == end_code) {
+      break;
+    }
+
+    if (code == clear_code) {
+      decoder->width = decoder->min_code_size + 1U;
+      decoder->width_limit = (uint16_t)(clear_code << 1U);
+      decoder->has_previous = false;
+      continue;
+    }
+
+    if (decoder->reader.read_failed) {
+      break;
+    }
+
+    const bool is_valid = decoder->has_previous ? code <= decoder->next_code
+                                                : code < clear_code;
+    return is_valid ? GIF_LZW_OUTPUT_OVERFLOW : GIF_LZW_INVALID_CODE;
+  }
+
+  return decoder->reader.read_failed ? GIF_SOURCE_READ_FAIL : GIF_SUCCESS;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gif_engine/gif_engine.h"
+
+#define LZW_MAX_CODE_WIDTH 12U
+#define LZW_TABLE_SIZE (1U << LZW_MAX_CODE_WIDTH)
+
+#define LZW_READAHEAD_SIZE 4096U
+
+/**
+ * Reads variable width codes from the chain of sub-blocks of a frame. The
+ * chain was already validated by the parser, so the only bound that needs to
+ * be respected here is the total data length.
+ *
+ * If the frame was parsed from a source, then \c current moves through a
+ * readahead window, which is refilled from \c next_offset of the source when
+ * \c current reaches \c window_end. A failed read fills the window with
+ * zeros, so the decoding loops need no extra checks, and the failure is
+ * reported once they return.
+ */
+typedef struct lzw_reader {
+  const uint8_t* current;
+  size_t subblock_remaining;
+  size_t data_remaining;
+
+  const gif_source* source;
+  uint8_t* window;
+  const uint8_t* window_end;
+  uint64_t next_offset;
+  bool read_failed;
+
+  uint32_t bits;
+  uint8_t bit_count;
+} lzw_reader;
+
+typedef struct lzw_decoder lzw_decoder;
+
+typedef gif_result_code (*lzw_read_function)(lzw_decoder* decoder,
+                                             uint8_t* destination,
+                                             size_t count);
+
+/**
+ * State of the LZW decompressor for a single frame. Pixels are pulled out of
+ * it in arbitrarily sized pieces with ::lzw_decoder_read, so the caller can
+ * consume the output a row at a time without ever holding the whole frame.
+ *
+ * This struct is large, but it is meant to live on the stack, so decoding a
+ * frame needs no heap allocations.
+ */
+struct lzw_decoder {
+  lzw_reader reader;
+  lzw_read_function read;
+
+  size_t remaining;
+
+  uint8_t min_code_size;
+  uint8_t width;
+  uint16_t width_limit;
+  uint16_t next_code;
+  uint16_t previous_code;
+  uint8_t previous_first;
+  bool has_previous;
+
+  /* Tail of a string that did not fit into the destination of the read that
+   * produced it */
+  uint16_t pending_offset;
+  uint16_t pending_size;
+
+  uint16_t prefix[LZW_TABLE_SIZE];
+  uint8_t suffix[LZW_TABLE_SIZE];
+  uint16_t lengths[LZW_TABLE_SIZE];
+  uint8_t pending[LZW_TABLE_SIZE];
+
+  uint8_t readahead[LZW_READAHEAD_SIZE];
+};
+
+/**
+ * Runs the LZW state machine over the image data of \c frame without writing
+ * any output. Only the length of the string belonging to each code is tracked,
+ * which is enough to detect invalid codes and to count the pixels the stream
+ * would produce. The number of pixels seen before the stream ended or turned
+ * out to be invalid is output via the \c pixel_count parameter.
+ *
+ * This function does not allocate. \c source is the one the frame was parsed
+ * from, or \c NULL.
+ */
+gif_result_code lzw_verify(const gif_source* source,
+                           const gif_frame_data* frame,
+                           size_t* pixel_count);
+
+/**
+ * Prepares \c decoder for decompressing the image data of \c frame. The
+ * specialization of the decoding loop for the minimum code size of the frame
+ * is selected here, once per frame. \c source is the one the frame was
+ * parsed from, or \c NULL.
+ */
+gif_result_code lzw_decoder_init(lzw_decoder* decoder,
+                                 const gif_source* source,
+                                 const gif_frame_data* frame);
+
+/**
+ * Writes the next \c count palette indices of the frame to \c destination.
+ * The caller must not ask for more pixels than the frame has in total.
+ */
+static inline gif_result_code lzw_decoder_read(lzw_decoder* const decoder,
+                                               uint8_t* const destination,
+                                               const size_t count)
+{
+  const gif_result_code code = decoder->read(decoder, destination, count);
+  return decoder->reader.read_failed ? GIF_SOURCE_READ_FAIL : code;
+}
+
+/**
+ * Checks that the stream ends after all the pixels of the frame were read.
+ */
+gif_result_code lzw_decoder_finish(lzw_decoder* decoder);
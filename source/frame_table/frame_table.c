@@ -0,0 +1,95 @@
+#include "frame_table/frame_table.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "buffer_ops.h"
+
+/* The arrays are laid out in order of decreasing alignment, so each one
+ * starts suitably aligned right after the previous one */
+#define GIF_FRAME_TABLE_BYTES_PER_FRAME \
+  (sizeof(gif_frame_table_cold) + sizeof(uint32_t) * 2U \
+   + sizeof(gif_frame_rect) + sizeof(uint16_t) + sizeof(uint8_t))
+
+_Static_assert(sizeof(gif_frame_table_cold) % sizeof(uint32_t) == 0,
+               "Arrays after the cold array must stay aligned");
+_Static_assert(sizeof(gif_frame_rect) % sizeof(uint16_t) == 0,
+               "Arrays after the rect array must stay aligned");
+
+static void fill_frame(gif_frame_table* const table,
+                       const size_t index,
+                       const gif_frame_data* const frame)
+{
+  const gif_frame_descriptor* const descriptor = &frame->descriptor;
+  const gif_graphic_extension* const extension = &frame->graphic_extension;
+
+  table->data_offsets[index] = (uint32_t)frame->data_offset;
+  table->data_lengths[index] = (uint32_t)frame->data_length;
+  table->rects[index] = (gif_frame_rect) {
+      .left = descriptor->left,
+      .top = descriptor->top,
+      .width = descriptor->width,
+      .height = descriptor->height,
+  };
+  table->delays[index] = extension->delay;
+  table->disposal_methods[index] = (uint8_t)extension->packed.disposal_method;
+  table->cold[index] = (gif_frame_table_cold) {
+      .fingerprint = frame->fingerprint,
+      .local_color_table = frame->local_color_table,
+      .descriptor_packed = descriptor->packed,
+      .min_code_size = frame->min_code_size,
+      .user_input_flag = extension->packed.user_input_flag,
+      .transparent_color_flag = extension->packed.transparent_color_flag,
+      .transparent_color_index = extension->transparent_color_index,
+  };
+}
+
+gif_result_code gif_frame_table_build_impl(const gif_details* const details,
+                                           gif_frame_table* const table,
+                                           const gif_allocator allocator)
+{
+  memset(table, 0, sizeof(gif_frame_table));
+
+  /* Offsets and lengths both fit in 32 bits if the whole file does */
+  if (input_size(details) > UINT32_MAX) {
+    return GIF_FRAME_TABLE_OFFSET_OVERFLOW;
+  }
+
+  const size_t size = details->frame_vector.size;
+  if (size == 0) {
+    return GIF_SUCCESS;
+  }
+
+  if (size > SIZE_MAX / GIF_FRAME_TABLE_BYTES_PER_FRAME) {
+    return GIF_ALLOC_FAIL;
+  }
+
+  uint8_t* const allocation =
+      allocator(NULL, size * GIF_FRAME_TABLE_BYTES_PER_FRAME);
+  if (allocation == NULL) {
+    return GIF_ALLOC_FAIL;
+  }
+
+  uint8_t* cursor = allocation;
+#define TAKE_ARRAY(member) \
+  do { \
+    table->member = (void*)cursor; \
+    cursor += sizeof(*table->member) * size; \
+  } while (0)
+
+  TAKE_ARRAY(cold);
+  TAKE_ARRAY(data_offsets);
+  TAKE_ARRAY(data_lengths);
+  TAKE_ARRAY(rects);
+  TAKE_ARRAY(delays);
+  TAKE_ARRAY(disposal_methods);
+
+#undef TAKE_ARRAY
+
+  table->size = size;
+  for (size_t i = 0; i < size; ++i) {
+    fill_frame(table, i, &details->frame_vector.frames[i]);
+  }
+
+  return GIF_SUCCESS;
+}
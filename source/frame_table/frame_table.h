@@ -0,0 +1,7 @@
+#pragma once
+
+#include "gif_engine/gif_engine.h"
+
+gif_result_code gif_frame_table_build_impl(const gif_details* details,
+                                           gif_frame_table* table,
+                                           gif_allocator allocator);
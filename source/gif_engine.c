@@ -4,37 +4,188 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "context/context.h"
 #include "decode/decode.h"
+#include "decode/lzw.h"
+#include "frame_table/frame_table.h"
+#include "index/index.h"
 #include "parse/parse.h"
 #include "parse/parse_state.h"
+#include "parse/scan.h"
+#include "simd/simd.h"
+#include "timeline/timeline.h"
 
 gif_parse_result gif_parse(const void* buffer,
                            size_t buffer_size,
                            gif_details* const details,
                            const gif_allocator allocator)
 {
-  memset(details, 0, sizeof(gif_details));
-  if (buffer_size == 0) {
-    return (gif_parse_result) {.code = GIF_ZERO_SIZED_BUFFER};
+  return gif_parse_with_options(buffer, buffer_size, details, allocator, NULL);
+}
+
+/**
+ * Returns a parse state for \c details with no input attached yet.
+ */
+static gif_parse_state parse_state_for(gif_details* const details,
+                                       const gif_allocator allocator,
+                                       const gif_parse_options* const options,
+                                       gif_context* const context)
+{
+  if (options != NULL) {
+    details->limits = options->limits;
   }
 
-  gif_parse_state state = {
-      .current = (const uint8_t**)&buffer,
-      .remaining = &buffer_size,
+  return (gif_parse_state) {
       .details = details,
       .allocator = allocator,
+      .memory_used = 0,
+      .context = context,
+      .block_offsets = NULL,
+      .block_index = 0,
+      .frame_index = 0,
+      .stop_after_frames = options != NULL ? options->stop_after_frames : 0,
+      .keep_application_extensions =
+          options != NULL && options->keep_application_extensions,
+      .seen_graphics_control_extension = false,
+      .reached_tail = false,
       .data = NULL,
   };
+}
 
-  const gif_result_code code = gif_parse_impl(&state);
+/**
+ * The parallel scan has to see the whole file at once, and it only pays off
+ * for large ones.
+ */
+static bool is_parallel_parse(const gif_parse_state* const state,
+                              const gif_parse_options* const options)
+{
+  return options != NULL && options->executor != NULL
+      && options->executor->worker_count > 1U && options->deallocator != NULL
+      && state->source == NULL && state->stop_after_frames == 0
+      && (size_t)(state->end - state->base) >= GIF_PARALLEL_SCAN_MIN_SIZE;
+}
+
+static gif_parse_result run_parse(gif_parse_state* const state,
+                                  const gif_parse_options* const options)
+{
+  const gif_result_code code = is_parallel_parse(state, options)
+      ? gif_parse_parallel_impl(
+          state, options->executor, options->deallocator)
+      : gif_parse_impl(state);
 
+  /* The window of a source is gone once this function returns */
+  const bool has_position = code != GIF_SUCCESS && state->source == NULL;
   return (gif_parse_result) {
       .code = code,
-      .data = state.data,
-      .last_position = code == GIF_SUCCESS ? NULL : buffer,
+      .data = state->data,
+      .last_position = has_position ? state->current : NULL,
   };
 }
 
+/**
+ * Parses into \c details, which must be zeroed apart from a frame vector that
+ * may have capacity left from a previous file.
+ */
+static gif_parse_result parse_into(const void* const buffer,
+                                   const size_t buffer_size,
+                                   gif_details* const details,
+                                   const gif_allocator allocator,
+                                   const gif_parse_options* const options,
+                                   gif_context* const context)
+{
+  gif_parse_state state = parse_state_for(details, allocator, options, context);
+  if (buffer_size == 0) {
+    return (gif_parse_result) {.code = GIF_ZERO_SIZED_BUFFER};
+  }
+
+  const uint8_t* const bytes = buffer;
+  details->raw_data = bytes;
+  details->raw_data_size = buffer_size;
+
+  state.current = bytes;
+  state.end = bytes + buffer_size;
+  state.base = bytes;
+  return run_parse(&state, options);
+}
+
+gif_parse_result gif_parse_with_options(const void* const buffer,
+                                        const size_t buffer_size,
+                                        gif_details* const details,
+                                        const gif_allocator allocator,
+                                        const gif_parse_options* const options)
+{
+  memset(details, 0, sizeof(gif_details));
+  return parse_into(buffer, buffer_size, details, allocator, options, NULL);
+}
+
+gif_parse_result gif_parse_source(const gif_source* const source,
+                                  gif_details* const details,
+                                  const gif_allocator allocator,
+                                  const gif_parse_options* const options)
+{
+  memset(details, 0, sizeof(gif_details));
+  gif_parse_state state = parse_state_for(details, allocator, options, NULL);
+  if (source->size == 0) {
+    return (gif_parse_result) {.code = GIF_ZERO_SIZED_BUFFER};
+  }
+
+  details->source = source;
+
+  uint8_t window[GIF_PARSE_WINDOW_SIZE];
+  state.current = window;
+  state.end = window;
+  state.base = window;
+  state.source = source;
+  state.window = window;
+  return run_parse(&state, options);
+}
+
+void gif_context_init(gif_context* const context,
+                      const gif_allocator allocator,
+                      const gif_deallocator deallocator)
+{
+  gif_context_init_impl(context, allocator, deallocator);
+}
+
+gif_parse_result gif_context_parse(gif_context* const context,
+                                   const void* const buffer,
+                                   const size_t buffer_size,
+                                   const gif_parse_options* const options)
+{
+  gif_context_reset_impl(context);
+  return parse_into(buffer,
+                    buffer_size,
+                    &context->details,
+                    context->allocator,
+                    options,
+                    context);
+}
+
+gif_decode_result gif_context_decode(gif_context* const context)
+{
+  const gif_result_code code =
+      gif_decode_reusing_impl(&context->canvases,
+                              &context->canvases_capacity,
+                              &context->details,
+                              context->allocator,
+                              context->deallocator);
+
+  return (gif_decode_result) {
+      .code = code,
+      .data = code == GIF_SUCCESS ? context->canvases : NULL,
+  };
+}
+
+void gif_context_trim(gif_context* const context)
+{
+  gif_context_trim_impl(context);
+}
+
+void gif_context_free(gif_context* const context)
+{
+  gif_context_trim_impl(context);
+}
+
 gif_decode_result gif_decode(gif_details* const details,
                              const gif_allocator allocator)
 {
@@ -47,6 +198,158 @@ gif_decode_result gif_decode(gif_details* const details,
   };
 }
 
+size_t gif_dirty_tiles_size(const gif_details* const details,
+                            const uint16_t tile_size)
+{
+  return gif_dirty_tiles_size_impl(details, tile_size);
+}
+
+gif_result_code gif_decode_to_store(const gif_details* const details,
+                                    const gif_allocator allocator,
+                                    const gif_decode_options* const options,
+                                    gif_frame_store* const store)
+{
+  memset(store, 0, sizeof(gif_frame_store));
+
+  return gif_decode_to_store_impl(store, details, allocator, options);
+}
+
+void gif_frame_store_free(const gif_frame_store* const store,
+                          const gif_deallocator deallocator)
+{
+  gif_frame_store_free_impl(store, deallocator);
+}
+
+gif_result_code gif_decode_indexed(const gif_details* const details,
+                                   const gif_allocator allocator,
+                                   gif_indexed_frames* const frames)
+{
+  memset(frames, 0, sizeof(gif_indexed_frames));
+
+  return gif_decode_indexed_impl(frames, details, allocator);
+}
+
+gif_result_code gif_indexed_frame_expand(const gif_indexed_frames* const frames,
+                                         const size_t index,
+                                         const gif_decode_target* const target)
+{
+  return gif_indexed_frame_expand_impl(frames, index, target);
+}
+
+void gif_indexed_frames_free(const gif_indexed_frames* const frames,
+                             const gif_deallocator deallocator)
+{
+  deallocator(frames->indices);
+}
+
+gif_result_code gif_verify(const gif_details* const details,
+                           gif_frame_verify_result* const results)
+{
+  gif_result_code first_failure = GIF_SUCCESS;
+  const gif_frame_vector frame_vector = details->frame_vector;
+  for (size_t i = 0; i < frame_vector.size; ++i) {
+    gif_frame_verify_result* const result = &results[i];
+    result->code = lzw_verify(
+        details->source, &frame_vector.frames[i], &result->pixel_count);
+    if (first_failure == GIF_SUCCESS) {
+      first_failure = result->code;
+    }
+  }
+
+  return first_failure;
+}
+
+gif_result_code gif_decode_frame(const gif_details* const details,
+                                 const size_t frame_index,
+                                 const gif_decode_target* const target)
+{
+  return gif_decode_frame_impl(details, frame_index, target);
+}
+
+size_t gif_index_size(const gif_details* const details)
+{
+  return gif_index_size_impl(details);
+}
+
+gif_result_code gif_index_write(const gif_details* const details,
+                                void* const index,
+                                const size_t index_size)
+{
+  return gif_index_write_impl(details, index, index_size);
+}
+
+gif_result_code gif_index_load(const void* const index,
+                               const size_t index_size,
+                               const void* const buffer,
+                               const size_t buffer_size,
+                               gif_details* const details,
+                               const gif_allocator allocator)
+{
+  memset(details, 0, sizeof(gif_details));
+
+  return gif_index_load_impl(
+      index, index_size, buffer, buffer_size, details, allocator);
+}
+
+gif_result_code gif_frame_table_build(const gif_details* const details,
+                                      gif_frame_table* const table,
+                                      const gif_allocator allocator)
+{
+  return gif_frame_table_build_impl(details, table, allocator);
+}
+
+void gif_frame_table_free(const gif_frame_table* const table,
+                          const gif_deallocator deallocator)
+{
+  /* The cold array is the start of the single allocation */
+  deallocator(table->cold);
+}
+
+gif_result_code gif_decode_frame_parallel(const gif_details* const details,
+                                          const size_t frame_index,
+                                          const gif_decode_target* const target,
+                                          const gif_executor* const executor,
+                                          const gif_allocator allocator,
+                                          const gif_deallocator deallocator)
+{
+  return gif_decode_frame_parallel_impl(
+      details, frame_index, target, executor, allocator, deallocator);
+}
+
+gif_result_code gif_timeline_build(const gif_details* const details,
+                                   gif_timeline* const timeline,
+                                   const gif_allocator allocator)
+{
+  return gif_timeline_build_impl(details, timeline, allocator);
+}
+
+size_t gif_timeline_frame_at(const gif_timeline* const timeline,
+                             const uint64_t time)
+{
+  return gif_timeline_frame_at_impl(timeline, time);
+}
+
+void gif_timeline_free(const gif_timeline* const timeline,
+                       const gif_deallocator deallocator)
+{
+  deallocator(timeline->frame_ends);
+}
+
+gif_simd_level gif_simd_level_supported(void)
+{
+  return gif_simd_level_supported_impl();
+}
+
+gif_simd_level gif_simd_level_active(void)
+{
+  return gif_simd_level_active_impl();
+}
+
+gif_result_code gif_simd_level_force(const gif_simd_level level)
+{
+  return gif_simd_level_force_impl(level);
+}
+
 static void free_frame_vector(const gif_frame_vector frame_vector,
                               const gif_deallocator deallocator)
 {
@@ -67,4 +370,5 @@ void gif_free_details(const gif_details* const details,
 {
   deallocator(details->global_color_table);
   free_frame_vector(details->frame_vector, deallocator);
+  deallocator(details->application_extensions.extensions);
 }
@@ -0,0 +1,39 @@
+#include "hash.h"
+
+#include <string.h>
+
+#define HASH_PRIME 0x100000001B3ULL
+
+static uint64_t mix(uint64_t hash, const uint64_t value)
+{
+  hash ^= value;
+  hash *= HASH_PRIME;
+  return hash ^ (hash >> 29U);
+}
+
+uint64_t hash_bytes(uint64_t hash, const uint8_t* data, size_t size)
+{
+  const size_t length = size;
+  for (; size >= 8U; size -= 8U, data += 8) {
+    uint64_t chunk;
+    memcpy(&chunk, data, sizeof(chunk));
+    hash = mix(hash, chunk);
+  }
+
+  if (size != 0) {
+    uint64_t tail = 0;
+    for (size_t i = 0; i < size; ++i) {
+      tail |= (uint64_t)data[i] << (i * 8U);
+    }
+    hash = mix(hash, tail);
+  }
+
+  /* Folding the length in keeps streams that differ only in trailing zero
+   * bytes apart */
+  return mix(hash, length);
+}
+
+uint64_t hash_u64(const uint64_t hash, const uint64_t value)
+{
+  return mix(hash, value);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The starting value for ::hash_bytes and ::hash_u64 chains.
+ */
+#define HASH_SEED 0xCBF29CE484222325ULL
+
+/**
+ * Mixes \c size bytes starting at \c data into \c hash. The input is consumed
+ * 8 bytes at a time, so hashing the compressed frame data costs about as much
+ * as a \c memcpy of it.
+ *
+ * @return The updated hash value
+ */
+uint64_t hash_bytes(uint64_t hash, const uint8_t* data, size_t size);
+
+/**
+ * Mixes a single 64 bit value into \c hash.
+ *
+ * @return The updated hash value
+ */
+uint64_t hash_u64(uint64_t hash, uint64_t value);
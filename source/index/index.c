@@ -0,0 +1,397 @@
+#include "index/index.h"
+
+#include <string.h>
+
+#include "binary_literal.h"
+#include "buffer_ops.h"
+#include "try.h"
+
+/*
+ * Layout of an index, all numbers are little-endian:
+ *
+ * header (48 bytes)
+ *   0  magic "GIFI"
+ *   4  u32 version
+ *   8  u64 size of the GIF file
+ *  16  u64 frame count
+ *  24  u16 canvas width, u16 canvas height
+ *  28  u8 packed byte of the logical screen descriptor as stored in the file,
+ *      u8 background color index, u8 pixel aspect ratio, u8 flags (bit 0 is
+ *      set if parsing stopped before the trailer, bit 1 is set if the file
+ *      has a loop extension)
+ *  32  u16 repeat count, u16 reserved, u32 reserved
+ *  40  u64 offset of the global color table, 0 if there is none
+ *
+ * frame record (48 bytes each)
+ *   0  u64 offset of the first sub-block's data
+ *   8  u64 data length
+ *  16  u64 fingerprint
+ *  24  u64 offset of the local color table, 0 if there is none
+ *  32  u16 left, u16 top, u16 width, u16 height
+ *  40  u8 packed byte of the image descriptor as stored in the file,
+ *      u8 minimum code size, u8 packed byte of the graphics control extension
+ *      as stored in the file, u8 transparent color index
+ *  44  u16 delay, u16 reserved
+ *
+ * Every offset is relative to the start of the GIF file.
+ */
+
+static const uint8_t index_magic[] = {'G', 'I', 'F', 'I'};
+
+#define GIF_INDEX_VERSION 2U
+#define GIF_INDEX_HEADER_SIZE 48U
+#define GIF_INDEX_FRAME_SIZE 48U
+
+static void write_u8(uint8_t** const cursor, const uint8_t value)
+{
+  **cursor = value;
+  ++*cursor;
+}
+
+static void write_u16(uint8_t** const cursor, const uint16_t value)
+{
+  write_u8(cursor, (uint8_t)value);
+  write_u8(cursor, (uint8_t)(value >> 8U));
+}
+
+static void write_u32(uint8_t** const cursor, const uint32_t value)
+{
+  write_u16(cursor, (uint16_t)value);
+  write_u16(cursor, (uint16_t)(value >> 16U));
+}
+
+static void write_u64(uint8_t** const cursor, const uint64_t value)
+{
+  write_u32(cursor, (uint32_t)value);
+  write_u32(cursor, (uint32_t)(value >> 32U));
+}
+
+static uint32_t read_u32(const uint8_t** const cursor)
+{
+  const uint32_t low = read_le_short_un(cursor);
+  const uint32_t high = read_le_short_un(cursor);
+  return high << 16U | low;
+}
+
+static uint64_t read_u64(const uint8_t** const cursor)
+{
+  const uint64_t low = read_u32(cursor);
+  const uint64_t high = read_u32(cursor);
+  return high << 32U | low;
+}
+
+size_t gif_index_size_impl(const gif_details* const details)
+{
+  return GIF_INDEX_HEADER_SIZE
+      + details->frame_vector.size * GIF_INDEX_FRAME_SIZE;
+}
+
+static uint8_t pack_descriptor(const gif_descriptor_packed* const packed)
+{
+  return (uint8_t)((packed->global_color_table_flag ? B8(10000000) : 0U)
+                   | (unsigned)packed->color_resolution << 4U
+                   | (packed->sort_flag ? B8(00001000) : 0U) | packed->size);
+}
+
+static uint8_t pack_frame_descriptor(
+    const gif_frame_descriptor_packed* const packed)
+{
+  return (uint8_t)((packed->local_color_table_flag ? B8(10000000) : 0U)
+                   | (packed->interlace_flag ? B8(01000000) : 0U)
+                   | (packed->sort_flag ? B8(00100000) : 0U) | packed->size);
+}
+
+static uint8_t pack_graphic_extension(
+    const gif_graphic_extension_packed* const packed)
+{
+  return (uint8_t)((unsigned)packed->disposal_method << 2U
+                   | (packed->user_input_flag ? B8(00000010) : 0U)
+                   | (packed->transparent_color_flag ? B8(00000001) : 0U));
+}
+
+/* The logical screen descriptor ends right after the header and the magic */
+#define GIF_GLOBAL_COLOR_TABLE_OFFSET 13U
+
+/**
+ * Returns the offset of the local color table of \c frame, which sits right
+ * before the minimum code size byte and the length byte of the first
+ * sub-block.
+ */
+static uint64_t local_color_table_offset(const gif_frame_data* const frame)
+{
+  const gif_frame_descriptor_packed* const packed = &frame->descriptor.packed;
+  if (!packed->local_color_table_flag) {
+    return 0;
+  }
+
+  return frame->data_offset - 2U - color_table_byte_size(packed->size);
+}
+
+gif_result_code gif_index_write_impl(const gif_details* const details,
+                                     void* const index,
+                                     const size_t index_size)
+{
+  if (index_size < gif_index_size_impl(details)) {
+    return GIF_INDEX_BUFFER_TOO_SMALL;
+  }
+
+  uint8_t* cursor = index;
+  memcpy(cursor, index_magic, sizeof(index_magic));
+  cursor += sizeof(index_magic);
+  write_u32(&cursor, GIF_INDEX_VERSION);
+  write_u64(&cursor, input_size(details));
+  write_u64(&cursor, details->frame_vector.size);
+
+  const gif_descriptor* const descriptor = &details->descriptor;
+  write_u16(&cursor, descriptor->canvas_width);
+  write_u16(&cursor, descriptor->canvas_height);
+  write_u8(&cursor, pack_descriptor(&descriptor->packed));
+  write_u8(&cursor, descriptor->background_color_index);
+  write_u8(&cursor, descriptor->pixel_aspect_ratio);
+  write_u8(&cursor,
+           (uint8_t)((details->is_partial ? 1U : 0U)
+                     | (details->has_loop_extension ? 2U : 0U)));
+  write_u16(&cursor, details->repeat_count);
+  write_u16(&cursor, 0);
+  write_u32(&cursor, 0);
+  write_u64(&cursor,
+            descriptor->packed.global_color_table_flag
+                ? GIF_GLOBAL_COLOR_TABLE_OFFSET
+                : 0U);
+
+  const gif_frame_vector frame_vector = details->frame_vector;
+  for (size_t i = 0; i < frame_vector.size; ++i) {
+    const gif_frame_data* const frame = &frame_vector.frames[i];
+    write_u64(&cursor, frame->data_offset);
+    write_u64(&cursor, frame->data_length);
+    write_u64(&cursor, frame->fingerprint);
+    write_u64(&cursor, local_color_table_offset(frame));
+
+    const gif_frame_descriptor* const frame_descriptor = &frame->descriptor;
+    write_u16(&cursor, frame_descriptor->left);
+    write_u16(&cursor, frame_descriptor->top);
+    write_u16(&cursor, frame_descriptor->width);
+    write_u16(&cursor, frame_descriptor->height);
+    write_u8(&cursor, pack_frame_descriptor(&frame_descriptor->packed));
+    write_u8(&cursor, frame->min_code_size);
+
+    const gif_graphic_extension* const extension = &frame->graphic_extension;
+    write_u8(&cursor, pack_graphic_extension(&extension->packed));
+    write_u8(&cursor, extension->transparent_color_index);
+    write_u16(&cursor, extension->delay);
+    write_u16(&cursor, 0);
+  }
+
+  return GIF_SUCCESS;
+}
+
+typedef struct gif_index_load_state {
+  const uint8_t* buffer;
+  size_t buffer_size;
+  gif_allocator allocator;
+} gif_index_load_state;
+
+/**
+ * Reads the color table referenced by \c offset from the GIF file. The offset
+ * comes from the index, so it has to be bounds checked like any other input.
+ */
+static gif_result_code load_color_table(const gif_index_load_state* const state,
+                                        const uint64_t offset,
+                                        uint32_t** const destination,
+                                        const uint8_t size)
+{
+  const size_t byte_size = color_table_byte_size(size);
+  if (offset == 0 || offset > state->buffer_size
+      || state->buffer_size - offset < byte_size)
+  {
+    return GIF_INDEX_DATA_MISMATCH;
+  }
+
+  const uint8_t* current = state->buffer + offset;
+  return read_color_table(&current, destination, size, state->allocator);
+}
+
+/**
+ * Walks the sub-block chain starting at \c offset to make sure the frame data
+ * described by the index lies within the GIF file, so the decoder never reads
+ * past it. This only touches one length byte per sub-block.
+ */
+static bool is_frame_data_in_bounds(const gif_index_load_state* const state,
+                                    const uint64_t offset,
+                                    const uint64_t data_length)
+{
+  if (offset == 0 || offset > state->buffer_size || data_length == 0) {
+    return false;
+  }
+
+  const uint8_t* current = state->buffer + offset - 1;
+  const uint8_t* const end = state->buffer + state->buffer_size;
+  uint64_t remaining = data_length;
+  while (remaining != 0) {
+    const uint8_t subblock_size = *current;
+    if (subblock_size == 0 || subblock_size > remaining
+        || (size_t)(end - current) <= subblock_size + 1U)
+    {
+      return false;
+    }
+
+    current += subblock_size + 1U;
+    remaining -= subblock_size;
+  }
+
+  return *current == 0;
+}
+
+static bool is_frame_invalid(const gif_descriptor* const descriptor,
+                             const gif_frame_data* const frame)
+{
+  const gif_frame_descriptor* const frame_descriptor = &frame->descriptor;
+  return frame_descriptor->width == 0 || frame_descriptor->height == 0
+      || (uint32_t)frame_descriptor->left + frame_descriptor->width
+      > descriptor->canvas_width
+      || (uint32_t)frame_descriptor->top + frame_descriptor->height
+      > descriptor->canvas_height;
+}
+
+static gif_result_code load_frame(const gif_index_load_state* const state,
+                                  const uint8_t** const cursor,
+                                  const gif_descriptor* const descriptor,
+                                  gif_frame_data* const frame)
+{
+  const uint64_t data_offset = read_u64(cursor);
+  const uint64_t data_length = read_u64(cursor);
+  frame->fingerprint = read_u64(cursor);
+  const uint64_t color_table_offset = read_u64(cursor);
+
+  gif_frame_descriptor* const frame_descriptor = &frame->descriptor;
+  frame_descriptor->left = read_le_short_un(cursor);
+  frame_descriptor->top = read_le_short_un(cursor);
+  frame_descriptor->width = read_le_short_un(cursor);
+  frame_descriptor->height = read_le_short_un(cursor);
+
+  const uint8_t packed_byte = read_byte_un(cursor);
+  gif_frame_descriptor_packed* const packed = &frame_descriptor->packed;
+  packed->local_color_table_flag = (packed_byte & B8(10000000)) != 0;
+  packed->interlace_flag = (packed_byte & B8(01000000)) != 0;
+  packed->sort_flag = (packed_byte & B8(00100000)) != 0;
+  packed->size = packed_byte & B8(00000111);
+
+  frame->min_code_size = read_byte_un(cursor);
+
+  gif_graphic_extension* const extension = &frame->graphic_extension;
+  const uint8_t extension_byte = read_byte_un(cursor);
+  const uint8_t disposal_method = (extension_byte & B8(00011100)) >> 2U;
+  extension->packed.disposal_method = (gif_disposal_method)disposal_method;
+  extension->packed.user_input_flag = (extension_byte & B8(00000010)) != 0;
+  extension->packed.transparent_color_flag = extension_byte & B8(00000001);
+  extension->transparent_color_index = read_byte_un(cursor);
+  extension->delay = read_le_short_un(cursor);
+  *cursor += 2;
+
+  if (disposal_method > 3U || is_frame_invalid(descriptor, frame)) {
+    return GIF_INDEX_INVALID;
+  }
+
+  if (!is_frame_data_in_bounds(state, data_offset, data_length)) {
+    return GIF_INDEX_DATA_MISMATCH;
+  }
+
+  frame->first_subblock = state->buffer + data_offset;
+  frame->data_offset = data_offset;
+  frame->data_length = (size_t)data_length;
+
+  if (packed->local_color_table_flag) {
+    TRY(load_color_table(
+        state, color_table_offset, &frame->local_color_table, packed->size));
+  }
+
+  return GIF_SUCCESS;
+}
+
+gif_result_code gif_index_load_impl(const uint8_t* const index,
+                                    const size_t index_size,
+                                    const uint8_t* const buffer,
+                                    const size_t buffer_size,
+                                    gif_details* const details,
+                                    const gif_allocator allocator)
+{
+  if (index_size < GIF_INDEX_HEADER_SIZE
+      || memcmp(index, index_magic, sizeof(index_magic)) != 0)
+  {
+    return GIF_INDEX_INVALID;
+  }
+
+  const uint8_t* cursor = index + sizeof(index_magic);
+  if (read_u32(&cursor) != GIF_INDEX_VERSION) {
+    return GIF_INDEX_VERSION_MISMATCH;
+  }
+
+  if (read_u64(&cursor) != buffer_size) {
+    return GIF_INDEX_DATA_MISMATCH;
+  }
+
+  const uint64_t frame_count = read_u64(&cursor);
+  const size_t max_frame_count =
+      (index_size - GIF_INDEX_HEADER_SIZE) / GIF_INDEX_FRAME_SIZE;
+  if (frame_count == 0 || frame_count > max_frame_count) {
+    return GIF_INDEX_INVALID;
+  }
+
+  gif_descriptor* const descriptor = &details->descriptor;
+  descriptor->canvas_width = read_le_short_un(&cursor);
+  descriptor->canvas_height = read_le_short_un(&cursor);
+
+  const uint8_t packed_byte = read_byte_un(&cursor);
+  gif_descriptor_packed* const packed = &descriptor->packed;
+  packed->global_color_table_flag = (packed_byte & B8(10000000)) != 0;
+  packed->color_resolution = (packed_byte & B8(01110000)) >> 4U;
+  packed->sort_flag = (packed_byte & B8(00001000)) != 0;
+  packed->size = packed_byte & B8(00000111);
+
+  descriptor->background_color_index = read_byte_un(&cursor);
+  descriptor->pixel_aspect_ratio = read_byte_un(&cursor);
+  const uint8_t flags = read_byte_un(&cursor);
+  details->is_partial = (flags & 1U) != 0;
+  details->has_loop_extension = (flags & 2U) != 0;
+  details->repeat_count = read_le_short_un(&cursor);
+  cursor += 6;
+  const uint64_t global_color_table_offset = read_u64(&cursor);
+
+  details->raw_data = buffer;
+  details->raw_data_size = buffer_size;
+
+  const gif_index_load_state state = {
+      .buffer = buffer,
+      .buffer_size = buffer_size,
+      .allocator = allocator,
+  };
+
+  if (packed->global_color_table_flag) {
+    TRY(load_color_table(&state,
+                         global_color_table_offset,
+                         &details->global_color_table,
+                         packed->size));
+  }
+
+  const size_t count = (size_t)frame_count;
+  gif_frame_data* const frames =
+      allocator(NULL, sizeof(gif_frame_data) * count);
+  if (frames == NULL) {
+    return GIF_ALLOC_FAIL;
+  }
+
+  /* The vector is complete from the start, so ::gif_free_details frees
+   * whatever has been loaded if a later frame fails */
+  memset(frames, 0, sizeof(gif_frame_data) * count);
+  details->frame_vector = (gif_frame_vector) {
+      .frames = frames,
+      .size = count,
+      .capacity = count,
+  };
+
+  for (size_t i = 0; i < count; ++i) {
+    TRY(load_frame(&state, &cursor, descriptor, &frames[i]));
+  }
+
+  return GIF_SUCCESS;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "gif_engine/gif_engine.h"
+
+size_t gif_index_size_impl(const gif_details* details);
+
+gif_result_code gif_index_write_impl(const gif_details* details,
+                                     void* index,
+                                     size_t index_size);
+
+gif_result_code gif_index_load_impl(const uint8_t* index,
+                                    size_t index_size,
+                                    const uint8_t* buffer,
+                                    size_t buffer_size,
+                                    gif_details* details,
+                                    gif_allocator allocator);
@@ -5,76 +5,247 @@
 
 #include "binary_literal.h"
 #include "buffer_ops.h"
+#include "hash.h"
 #include "try.h"
 
-#define CHECK_STATE_REMAINING(value) \
+static size_t remaining(const gif_parse_state* const state)
+{
+  return (size_t)(state->end - state->current);
+}
+
+static uint64_t current_offset(const gif_parse_state* const state)
+{
+  return state->base_offset + (uint64_t)(state->current - state->base);
+}
+
+/**
+ * Moves what is left of the window to its front and fills the rest from the
+ * source, so that at least \c required bytes are available.
+ */
+static gif_result_code refill_window(gif_parse_state* const state,
+                                     const size_t required)
+{
+  const gif_source* const source = state->source;
+  if (source == NULL || required > GIF_PARSE_WINDOW_SIZE) {
+    return GIF_READ_PAST_BUFFER;
+  }
+
+  const size_t kept = remaining(state);
+  memmove(state->window, state->current, kept);
+  state->base_offset = current_offset(state);
+  state->base = state->window;
+  state->current = state->window;
+
+  const uint64_t file_left = source->size - state->base_offset - kept;
+  size_t size = GIF_PARSE_WINDOW_SIZE - kept;
+  if (size > file_left) {
+    size = (size_t)file_left;
+  }
+
+  if (kept + size < required) {
+    state->end = state->window + kept;
+    return GIF_READ_PAST_BUFFER;
+  }
+
+  if (!source->read(source->context,
+                    state->base_offset + kept,
+                    state->window + kept,
+                    size))
+  {
+    return GIF_SOURCE_READ_FAIL;
+  }
+
+  state->end = state->window + kept + size;
+  return GIF_SUCCESS;
+}
+
+/**
+ * Bounds checks a whole record at once, so its fields can be read without any
+ * further checks.
+ */
+#define REQUIRE_REMAINING(value) \
+  do { \
+    if (remaining(state) < (value)) { \
+      TRY(refill_window(state, (value))); \
+    } \
+  } while (0)
+
+/**
+ * Compares the next bytes with \c buffer, which must already be bounds
+ * checked, and advances past them if they match.
+ */
+#define CONST_CHECK_UN(buffer, code) \
   do { \
-    const size_t value_to_check = (value); \
-    if (*state->remaining < value_to_check) { \
-      return GIF_READ_PAST_BUFFER; \
+    if (memcmp(state->current, buffer, sizeof(buffer)) != 0) { \
+      return code; \
     } \
-    *state->remaining -= value_to_check; \
+    state->current += sizeof(buffer); \
   } while (0)
 
 static const uint8_t magic[] = {'G', 'I', 'F'};
 
-static compare_result is_gif_file(gif_parse_state* const state)
+static const uint8_t gif87a_version[] = {'8', '7', 'a'};
+
+static const uint8_t gif89a_version[] = {'8', '9', 'a'};
+
+_Static_assert(sizeof(gif87a_version) == sizeof(gif89a_version),
+               "The versions must be the same length");
+
+/**
+ * GIF87a files are a subset of GIF89a ones, so both are read the same way.
+ */
+static bool is_gif_version_supported(const uint8_t* const version)
+{
+  return memcmp(version, gif89a_version, sizeof(gif89a_version)) == 0
+      || memcmp(version, gif87a_version, sizeof(gif87a_version)) == 0;
+}
+
+/**
+ * Carves \c count colors out of the color pool of the context being parsed
+ * into. If there is no context or its pool is too small, then \c NULL is
+ * returned, and in the latter case the shortfall is recorded so the pool can
+ * grow before the next file.
+ */
+static uint32_t* take_pooled_colors(const gif_parse_state* const state,
+                                    const size_t count)
 {
-  return buffer_is_eq(state->current, state->remaining, magic, sizeof(magic));
+  gif_context* const context = state->context;
+  if (context == NULL) {
+    return NULL;
+  }
+
+  if (context->color_pool_capacity - context->color_pool_used < count) {
+    context->color_pool_overflow += count;
+    return NULL;
+  }
+
+  uint32_t* const colors = &context->color_pool[context->color_pool_used];
+  context->color_pool_used += count;
+  return colors;
 }
 
-static const uint8_t gif_version[] = {'8', '9', 'a'};
+static gif_result_code read_tracked_color_table(gif_parse_state* const state,
+                                                uint32_t** const destination,
+                                                const uint8_t size)
+{
+  REQUIRE_REMAINING(color_table_byte_size(size));
+
+  const size_t allocation_size = color_table_allocation_size(size);
+  if (exceeds_memory_limit(state, allocation_size)) {
+    return GIF_MEMORY_LIMIT_EXCEEDED;
+  }
+
+  uint32_t* const pooled =
+      take_pooled_colors(state, allocation_size / sizeof(uint32_t));
+  if (pooled != NULL) {
+    read_color_table_into(&state->current, pooled, size);
+    *destination = pooled;
+  } else {
+    TRY(read_color_table(
+        &state->current, destination, size, state->allocator));
+  }
+
+  state->memory_used += allocation_size;
+  return GIF_SUCCESS;
+}
 
-static compare_result is_gif_version_supported(gif_parse_state* const state)
+static uint64_t canvas_pixels(const gif_descriptor* const descriptor)
 {
-  return buffer_is_eq(
-      state->current, state->remaining, gif_version, sizeof(gif_version));
+  return (uint64_t)descriptor->canvas_width * descriptor->canvas_height;
 }
 
 #define LOGICAL_SCREEN_DESCRIPTOR_SIZE 7U
 
 static gif_result_code read_descriptor(gif_parse_state* const state)
 {
-  CHECK_STATE_REMAINING(LOGICAL_SCREEN_DESCRIPTOR_SIZE);
+  REQUIRE_REMAINING(LOGICAL_SCREEN_DESCRIPTOR_SIZE);
 
   gif_descriptor* const descriptor = &state->details->descriptor;
-  descriptor->canvas_width = read_le_short_un(state->current);
-  descriptor->canvas_height = read_le_short_un(state->current);
+  descriptor->canvas_width = read_le_short_un(&state->current);
+  descriptor->canvas_height = read_le_short_un(&state->current);
 
-  const uint8_t packed_byte = read_byte_un(state->current);
+  const uint8_t packed_byte = read_byte_un(&state->current);
   gif_descriptor_packed* const packed = &descriptor->packed;
   packed->global_color_table_flag = (packed_byte & B8(10000000)) != 0;
   packed->color_resolution = (packed_byte & B8(01110000)) >> 4U;
   packed->sort_flag = (packed_byte & B8(00001000)) != 0;
   packed->size = packed_byte & B8(00000111);
 
-  descriptor->background_color_index = read_byte_un(state->current);
-  descriptor->pixel_aspect_ratio = read_byte_un(state->current);
+  descriptor->background_color_index = read_byte_un(&state->current);
+  descriptor->pixel_aspect_ratio = read_byte_un(&state->current);
+
+  const uint64_t max_canvas_pixels =
+      state->details->limits.max_canvas_pixels;
+  if (max_canvas_pixels != 0 && canvas_pixels(descriptor) > max_canvas_pixels)
+  {
+    return GIF_CANVAS_LIMIT_EXCEEDED;
+  }
 
   return GIF_SUCCESS;
 }
 
-typedef enum gif_extension_type {
-  GIF_GRAPHICS_CONTROL_EXTENSION = 0xF9,
-  GIF_APPLICATION_EXTENSION = 0xFF,
-  GIF_COMMENT_EXTENSION = 0xFE,
-  GIF_TEXT_EXTENSION = 0x01,
-} gif_extension_type;
+static gif_result_code read_header(gif_parse_state* const state)
+{
+  REQUIRE_REMAINING(sizeof(magic));
+  CONST_CHECK_UN(magic, GIF_NOT_A_GIF);
+
+  REQUIRE_REMAINING(sizeof(gif89a_version));
+  if (!is_gif_version_supported(state->current)) {
+    return GIF_NOT_A_GIF89A;
+  }
+  state->current += sizeof(gif89a_version);
+
+  TRY(read_descriptor(state));
+
+  if (state->details->descriptor.packed.global_color_table_flag) {
+    TRY(read_tracked_color_table(state,
+                                 &state->details->global_color_table,
+                                 state->details->descriptor.packed.size));
+  }
 
-static bool skip_block(const uint8_t** const current, size_t* const remaining)
+  return GIF_SUCCESS;
+}
+
+/**
+ * Skips a chain of sub-blocks up to and including the terminating null
+ * sub-block. Each sub-block is bounds checked together with the length byte of
+ * the next one.
+ */
+static gif_result_code skip_block(gif_parse_state* const state)
 {
+  REQUIRE_REMAINING(1U);
   while (1) {
-    uint8_t subblock_size;
-    if (!read_byte(current, remaining, &subblock_size)) {
-      return false;
-    }
+    const uint8_t subblock_size = read_byte_un(&state->current);
     if (subblock_size == 0) {
-      return true;
+      return GIF_SUCCESS;
     }
-    if (!skip_bytes(current, remaining, subblock_size)) {
-      return false;
+
+    REQUIRE_REMAINING(subblock_size + 1U);
+    state->current += subblock_size;
+  }
+}
+
+/* Bytes per pixel of the RGBA output of the decoder */
+#define GIF_DECODED_PIXEL_SIZE 4U
+
+static gif_result_code check_frame_limits(const gif_parse_state* const state,
+                                          const size_t frame_count)
+{
+  const gif_limits* const limits = &state->details->limits;
+  if (limits->max_frames != 0 && frame_count > limits->max_frames) {
+    return GIF_FRAME_LIMIT_EXCEEDED;
+  }
+
+  const uint64_t max_decoded_bytes = limits->max_total_decoded_bytes;
+  if (max_decoded_bytes != 0) {
+    const uint64_t frame_bytes =
+        canvas_pixels(&state->details->descriptor) * GIF_DECODED_PIXEL_SIZE;
+    if (frame_bytes != 0 && frame_count > max_decoded_bytes / frame_bytes) {
+      return GIF_DECODED_SIZE_LIMIT_EXCEEDED;
     }
   }
+
+  return GIF_SUCCESS;
 }
 
 #define GIF_FRAME_VECTOR_GROWTH 10U
@@ -89,7 +260,16 @@ static gif_result_code ensure_frame_data(gif_parse_state* const state,
   const size_t capacity = frame_vector->capacity;
   assert(frame_index <= capacity);
 
+  if (frame_index == frame_vector->size) {
+    TRY(check_frame_limits(state, frame_index + 1));
+  }
+
   if (capacity == frame_index) {
+    const size_t growth = sizeof(gif_frame_data) * GIF_FRAME_VECTOR_GROWTH;
+    if (exceeds_memory_limit(state, growth)) {
+      return GIF_MEMORY_LIMIT_EXCEEDED;
+    }
+
     const size_t new_capacity = capacity + GIF_FRAME_VECTOR_GROWTH;
     const size_t byte_length = sizeof(gif_frame_data) * new_capacity;
     gif_frame_data* const frames_allocation =
@@ -105,6 +285,7 @@ static gif_result_code ensure_frame_data(gif_parse_state* const state,
 
     frame_vector->capacity = new_capacity;
     frame_vector->frames = frames_allocation;
+    state->memory_used += growth;
   }
 
   /* Same sanity check as above */
@@ -122,22 +303,28 @@ static gif_result_code ensure_frame_data(gif_parse_state* const state,
 #define GIF_GRAPHICS_CONTROL_EXTENSION_SIZE 4U
 
 static gif_result_code read_graphics_control_extension(
-    gif_parse_state* const state, const size_t frame_index)
+    gif_parse_state* const state)
 {
+  if (state->seen_graphics_control_extension) {
+    return GIF_MULTIPLE_GRAPHICS_CONTROL_EXTENSIONS;
+  }
+  state->seen_graphics_control_extension = true;
+
   /* The plus two comes from the length byte itself and the terminating null
    * byte */
-  CHECK_STATE_REMAINING(GIF_GRAPHICS_CONTROL_EXTENSION_SIZE + 2U);
+  REQUIRE_REMAINING(GIF_GRAPHICS_CONTROL_EXTENSION_SIZE + 2U);
 
+  const size_t frame_index = state->frame_index;
   TRY(ensure_frame_data(state, frame_index));
 
-  if (read_byte_un(state->current) != GIF_GRAPHICS_CONTROL_EXTENSION_SIZE) {
+  if (read_byte_un(&state->current) != GIF_GRAPHICS_CONTROL_EXTENSION_SIZE) {
     return GIF_GRAPHICS_CONTROL_EXTENSION_SIZE_MISMATCH;
   }
 
-  const uint8_t packed_byte = read_byte_un(state->current);
-  const uint16_t delay = read_le_short_un(state->current);
-  const uint8_t transparent_color_index = read_byte_un(state->current);
-  const uint8_t terminator = read_byte_un(state->current);
+  const uint8_t packed_byte = read_byte_un(&state->current);
+  const uint16_t delay = read_le_short_un(&state->current);
+  const uint8_t transparent_color_index = read_byte_un(&state->current);
+  const uint8_t terminator = read_byte_un(&state->current);
   if (terminator != 0) {
     return GIF_GRAPHICS_CONTROL_EXTENSION_NULL_MISSING;
   }
@@ -174,98 +361,150 @@ _Static_assert(sizeof(netscape_auth_code) == 3U,
 #define GIF_APPLICATION_EXTENSION_SIZE 11U
 #define GIF_NETSCAPE_SUBBLOCK_SIZE 3U
 #define GIF_NETSCAPE_SUBBLOCK_ID 1U
+#define GIF_APPLICATION_EXTENSION_VECTOR_GROWTH 4U
+
+_Static_assert(sizeof(((gif_application_extension*)NULL)->identifier)
+                   == GIF_APPLICATION_EXTENSION_SIZE,
+               "The identifier must hold the whole application block");
+
+static bool is_netscape_extension(const uint8_t* const identifier)
+{
+  return memcmp(identifier, netscape_identifier, sizeof(netscape_identifier))
+      == 0
+      && memcmp(&identifier[sizeof(netscape_identifier)],
+                netscape_auth_code,
+                sizeof(netscape_auth_code))
+      == 0;
+}
+
+static gif_result_code push_application_extension(
+    gif_parse_state* const state,
+    const gif_application_extension* const extension)
+{
+  gif_application_extension_vector* const vector =
+      &state->details->application_extensions;
+  if (vector->size == vector->capacity) {
+    const size_t growth = sizeof(gif_application_extension)
+        * GIF_APPLICATION_EXTENSION_VECTOR_GROWTH;
+    if (exceeds_memory_limit(state, growth)) {
+      return GIF_MEMORY_LIMIT_EXCEEDED;
+    }
+
+    const size_t new_capacity =
+        vector->capacity + GIF_APPLICATION_EXTENSION_VECTOR_GROWTH;
+    gif_application_extension* const extensions = state->allocator(
+        vector->extensions, sizeof(gif_application_extension) * new_capacity);
+    if (extensions == NULL) {
+      if (vector->extensions == NULL) {
+        return GIF_ALLOC_FAIL;
+      }
+
+      state->data = vector->extensions;
+      return GIF_REALLOC_FAIL;
+    }
+
+    vector->extensions = extensions;
+    vector->capacity = new_capacity;
+    state->memory_used += growth;
+  }
+
+  vector->extensions[vector->size++] = *extension;
+  return GIF_SUCCESS;
+}
+
+/**
+ * Skips the data of an application extension the parser does not use, and
+ * lists it in the details if that was asked for. The identifier is bounds
+ * checked already.
+ */
+static gif_result_code skip_application_extension(gif_parse_state* const state)
+{
+  gif_application_extension extension = {.frame_index = state->frame_index};
+  memcpy(extension.identifier, state->current, sizeof(extension.identifier));
+  state->current += sizeof(extension.identifier);
+
+  extension.offset = current_offset(state);
+  extension.subblocks = state->source == NULL ? state->current : NULL;
+  TRY(skip_block(state));
+  extension.size = (size_t)(current_offset(state) - extension.offset);
+
+  if (!state->keep_application_extensions) {
+    return GIF_SUCCESS;
+  }
+
+  return push_application_extension(state, &extension);
+}
 
 static gif_result_code read_application_extension(gif_parse_state* const state)
 {
   /* The plus two comes from the length byte itself and the subblock length
    * byte, which could potentially be the terminating null byte */
-  CHECK_STATE_REMAINING(GIF_APPLICATION_EXTENSION_SIZE + 2U);
+  REQUIRE_REMAINING(GIF_APPLICATION_EXTENSION_SIZE + 2U);
 
-  if (read_byte_un(state->current) != GIF_APPLICATION_EXTENSION_SIZE) {
+  if (read_byte_un(&state->current) != GIF_APPLICATION_EXTENSION_SIZE) {
     return GIF_APPLICATION_EXTENSION_SIZE_MISMATCH;
   }
 
-#define CONST_CHECK_UN(buffer, code) \
-  do { \
-    if (memcmp(*state->current, buffer, sizeof(buffer)) != 0) { \
-      return code; \
-    } \
-    *state->current += sizeof(buffer); \
-  } while (0)
-
-  CONST_CHECK_UN(netscape_identifier, GIF_NOT_A_NETSCAPE_EXTENSION);
-  CONST_CHECK_UN(netscape_auth_code, GIF_NOT_A_NETSCAPE_20_EXTENSION);
+  if (!is_netscape_extension(state->current)) {
+    return skip_application_extension(state);
+  }
+  state->current += GIF_APPLICATION_EXTENSION_SIZE;
 
-  const uint8_t subblock_length = read_byte_un(state->current);
+  const uint8_t subblock_length = read_byte_un(&state->current);
   if (subblock_length != GIF_NETSCAPE_SUBBLOCK_SIZE) {
     return GIF_INCORRECT_NETSCAPE_SUBBLOCK_SIZE;
   }
 
-  uint8_t subblock_id;
-  if (!read_byte(state->current, state->remaining, &subblock_id)) {
-    return GIF_READ_PAST_BUFFER;
-  }
+  /* The sub-block itself and the terminating null byte */
+  REQUIRE_REMAINING(GIF_NETSCAPE_SUBBLOCK_SIZE + 1U);
 
-  if (subblock_id != GIF_NETSCAPE_SUBBLOCK_ID) {
+  if (read_byte_un(&state->current) != GIF_NETSCAPE_SUBBLOCK_ID) {
     return GIF_INCORRECT_NETSCAPE_SUBBLOCK_ID;
   }
 
-  uint16_t repeat_count;
-  if (!read_le_short(state->current, state->remaining, &repeat_count)) {
-    return GIF_READ_PAST_BUFFER;
-  }
-
-  uint8_t terminator_byte;
-  if (!read_byte(state->current, state->remaining, &terminator_byte)) {
-    return GIF_READ_PAST_BUFFER;
-  }
-
-  if (terminator_byte != 0) {
+  const uint16_t repeat_count = read_le_short_un(&state->current);
+  if (read_byte_un(&state->current) != 0) {
     return GIF_NETSCAPE_NULL_MISSING;
   }
 
   state->details->repeat_count = repeat_count;
+  state->details->has_loop_extension = true;
   return GIF_SUCCESS;
 }
 
-static gif_result_code read_extension_block(
-    gif_parse_state* const state,
-    const size_t frame_index,
-    bool* const seen_graphics_control_extension)
-{
-  uint8_t extension_type_byte;
-  if (!read_byte(state->current, state->remaining, &extension_type_byte)) {
-    return GIF_READ_PAST_BUFFER;
-  }
+typedef gif_result_code (*gif_block_handler)(gif_parse_state* state);
 
-  const gif_extension_type extension_type =
-      (gif_extension_type)extension_type_byte;
-  switch (extension_type) {
-    case GIF_GRAPHICS_CONTROL_EXTENSION: {
-      if (*seen_graphics_control_extension) {
-        return GIF_MULTIPLE_GRAPHICS_CONTROL_EXTENSIONS;
-      }
-      *seen_graphics_control_extension = true;
+typedef enum gif_extension_type {
+  GIF_GRAPHICS_CONTROL_EXTENSION = 0xF9,
+  GIF_APPLICATION_EXTENSION = 0xFF,
+  GIF_COMMENT_EXTENSION = 0xFE,
+  GIF_TEXT_EXTENSION = 0x01,
+} gif_extension_type;
 
-      TRY(read_graphics_control_extension(state, frame_index));
-      break;
-    }
-    case GIF_APPLICATION_EXTENSION: {
-      TRY(read_application_extension(state));
-      break;
-    }
-    case GIF_COMMENT_EXTENSION:
-      /* fallthrough */
-    case GIF_TEXT_EXTENSION:
-      if (!skip_block(state->current, state->remaining)) {
-        return GIF_READ_PAST_BUFFER;
-      }
-      break;
-    default:
-      return GIF_UNKNOWN_EXTENSION;
+/**
+ * Handlers for the label byte following the extension introducer. Labels
+ * without a handler are unknown extensions, which are skipped.
+ */
+static const gif_block_handler extension_handlers[256] = {
+    [GIF_GRAPHICS_CONTROL_EXTENSION] = &read_graphics_control_extension,
+    [GIF_APPLICATION_EXTENSION] = &read_application_extension,
+    [GIF_COMMENT_EXTENSION] = &skip_block,
+    [GIF_TEXT_EXTENSION] = &skip_block,
+};
+
+static gif_result_code read_extension_block(gif_parse_state* const state)
+{
+  REQUIRE_REMAINING(1U);
+
+  const gif_block_handler handler =
+      extension_handlers[read_byte_un(&state->current)];
+  if (handler == NULL) {
+    /* Nothing needed for decoding can be in an extension added after
+     * GIF89a, so its sub-blocks are only walked over */
+    return skip_block(state);
   }
 
-  return GIF_SUCCESS;
+  return handler(state);
 }
 
 static bool is_frame_size_invalid(const gif_frame_descriptor* const descriptor)
@@ -286,22 +525,52 @@ static bool is_frame_out_of_bounds(const gif_descriptor* const descriptor,
       > descriptor->canvas_height;
 }
 
+/**
+ * Starts the fingerprint of a frame with everything that affects its decoded
+ * pixels besides the color table and the compressed data, which are mixed in
+ * by the caller as they are walked.
+ */
+static uint64_t fingerprint_frame(const gif_frame_data* const frame_data,
+                                  const uint8_t min_code_size)
+{
+  const gif_frame_descriptor* const descriptor = &frame_data->descriptor;
+  const gif_frame_descriptor_packed* const packed = &descriptor->packed;
+  const uint64_t geometry = (uint64_t)descriptor->left
+      | (uint64_t)descriptor->top << 16U | (uint64_t)descriptor->width << 32U
+      | (uint64_t)descriptor->height << 48U;
+  const uint64_t flags = (uint64_t)packed->local_color_table_flag
+      | (uint64_t)packed->interlace_flag << 1U | (uint64_t)packed->size << 8U
+      | (uint64_t)min_code_size << 16U;
+
+  /* The delay and the disposal method are left out on purpose, because they
+   * only affect what happens after the frame is drawn */
+  const gif_graphic_extension* const extension =
+      &frame_data->graphic_extension;
+  const uint64_t transparency =
+      (uint64_t)extension->packed.transparent_color_flag
+      | (uint64_t)extension->transparent_color_index << 8U;
+
+  uint64_t hash = hash_u64(HASH_SEED, geometry);
+  hash = hash_u64(hash, flags);
+  return hash_u64(hash, transparency);
+}
+
 #define GIF_IMAGE_DESCRIPTOR_SIZE 9U
 
-static gif_result_code read_image_descriptor_block(gif_parse_state* const state,
-                                                   const size_t frame_index)
+static gif_result_code read_image_descriptor_block(gif_parse_state* const state)
 {
-  CHECK_STATE_REMAINING(GIF_IMAGE_DESCRIPTOR_SIZE);
+  REQUIRE_REMAINING(GIF_IMAGE_DESCRIPTOR_SIZE);
 
+  const size_t frame_index = state->frame_index;
   TRY(ensure_frame_data(state, frame_index));
 
   gif_frame_data* const frame_data =
       &state->details->frame_vector.frames[frame_index];
   gif_frame_descriptor* const descriptor = &frame_data->descriptor;
-  descriptor->left = read_le_short_un(state->current);
-  descriptor->top = read_le_short_un(state->current);
-  descriptor->width = read_le_short_un(state->current);
-  descriptor->height = read_le_short_un(state->current);
+  descriptor->left = read_le_short_un(&state->current);
+  descriptor->top = read_le_short_un(&state->current);
+  descriptor->width = read_le_short_un(&state->current);
+  descriptor->height = read_le_short_un(&state->current);
 
 #define FRAME_CHECK(boolean, code) \
   do { \
@@ -315,120 +584,128 @@ static gif_result_code read_image_descriptor_block(gif_parse_state* const state,
   FRAME_CHECK(is_frame_out_of_bounds(&state->details->descriptor, descriptor),
               GIF_FRAME_OUT_OF_BOUNDS);
 
-  const uint8_t packed_byte = read_byte_un(state->current);
+  /* The decoder rejects streams that produce more than width * height
+   * pixels, so bounding the frame area bounds the LZW output as well */
+  const uint64_t max_frame_output = state->details->limits.max_frame_output;
+  FRAME_CHECK(max_frame_output != 0
+                  && (uint64_t)descriptor->width * descriptor->height
+                      > max_frame_output,
+              GIF_FRAME_OUTPUT_LIMIT_EXCEEDED);
+
+  const uint8_t packed_byte = read_byte_un(&state->current);
   gif_frame_descriptor_packed* const packed = &descriptor->packed;
   packed->local_color_table_flag = (packed_byte & B8(10000000)) != 0;
   packed->interlace_flag = (packed_byte & B8(01000000)) != 0;
   packed->sort_flag = (packed_byte & B8(00100000)) != 0;
   packed->size = packed_byte & B8(00000111);
 
+  /* The color table, the minimum code size and the length byte of the first
+   * sub-block. Checking them at once keeps the table in the window of a
+   * source until it is hashed below */
+  const size_t color_table_size = packed->local_color_table_flag
+      ? color_table_byte_size(packed->size)
+      : 0;
+  REQUIRE_REMAINING(color_table_size + 2U);
+
+  const uint8_t* const color_table_bytes = state->current;
   if (packed->local_color_table_flag) {
-    TRY(read_color_table(state->current,
-                         state->remaining,
-                         &frame_data->local_color_table,
-                         packed->size,
-                         state->allocator));
+    TRY(read_tracked_color_table(
+        state, &frame_data->local_color_table, packed->size));
   }
 
-  uint8_t min_code_size;
-  if (!read_byte(state->current, state->remaining, &min_code_size)) {
-    return GIF_READ_PAST_BUFFER;
-  }
+  const uint8_t min_code_size = read_byte_un(&state->current);
+  uint64_t fingerprint = fingerprint_frame(frame_data, min_code_size);
+  fingerprint = hash_bytes(fingerprint, color_table_bytes, color_table_size);
 
-  const uint8_t* const first_subblock = *state->current + 1;
+  const uint64_t data_offset = current_offset(state) + 1U;
+  const uint8_t* const first_subblock =
+      state->source == NULL ? state->current + 1 : NULL;
   size_t data_length = 0;
-  while (1) {
-    uint8_t subblock_size;
-    if (!read_byte(state->current, state->remaining, &subblock_size)) {
-      return GIF_READ_PAST_BUFFER;
-    }
-    if (subblock_size == 0) {
-      break;
-    }
-    if (!skip_bytes(state->current, state->remaining, subblock_size)) {
-      return GIF_READ_PAST_BUFFER;
+  if (state->block_offsets != NULL) {
+    /* The scan already walked the sub-blocks, they are hashed afterwards */
+    state->current =
+        state->base + state->block_offsets[state->block_index + 1U];
+  } else {
+    while (1) {
+      const uint8_t subblock_size = read_byte_un(&state->current);
+      if (subblock_size == 0) {
+        break;
+      }
+
+      /* The sub-block and the length byte of the next one */
+      REQUIRE_REMAINING(subblock_size + 1U);
+      fingerprint = hash_bytes(fingerprint, state->current, subblock_size);
+      state->current += subblock_size;
+      data_length += subblock_size;
     }
-    data_length += subblock_size;
-  }
 
-  if (data_length == 0) {
-    return GIF_FRAME_DATA_EMPTY;
+    if (data_length == 0) {
+      return GIF_FRAME_DATA_EMPTY;
+    }
   }
 
   frame_data->min_code_size = min_code_size;
   frame_data->first_subblock = first_subblock;
   frame_data->data_length = data_length;
+  frame_data->data_offset = data_offset;
+  frame_data->fingerprint = fingerprint;
+
+  ++state->frame_index;
+  state->seen_graphics_control_extension = false;
+  if (state->frame_index == state->stop_after_frames) {
+    state->details->is_partial = true;
+    state->reached_tail = true;
+  }
+
   return GIF_SUCCESS;
 }
 
-typedef enum gif_block_type {
-  GIF_EXTENSION_BLOCK = 0x21,
-  GIF_IMAGE_DESCRIPTOR_BLOCK = 0x2C,
-  GIF_TAIL_BLOCK = 0x3B,
-} gif_block_type;
-
-gif_result_code gif_parse_impl(gif_parse_state* const state)
+static gif_result_code read_tail_block(gif_parse_state* const state)
 {
-#define CONST_CHECK(predicate, fail_code) \
-  do { \
-    switch (predicate(state)) { \
-      case CMP_EQ: \
-        break; \
-      case CMP_NEQ: \
-        return fail_code; \
-      case CMP_OOB: \
-        return GIF_READ_PAST_BUFFER; \
-    } \
-  } while (0)
-
-  CONST_CHECK(is_gif_file, GIF_NOT_A_GIF);
-  CONST_CHECK(is_gif_version_supported, GIF_NOT_A_GIF89A);
+  if (state->frame_index == 0) {
+    return GIF_IMAGE_DESCRIPTOR_MISSING;
+  }
 
-  TRY(read_descriptor(state));
+  state->reached_tail = true;
+  return GIF_SUCCESS;
+}
 
-  if (state->details->descriptor.packed.global_color_table_flag) {
-    TRY(read_color_table(state->current,
-                         state->remaining,
-                         &state->details->global_color_table,
-                         state->details->descriptor.packed.size,
-                         state->allocator));
-  }
+/**
+ * Handlers for the byte introducing each block after the header. Bytes without
+ * a handler are unknown blocks.
+ */
+static const gif_block_handler block_handlers[256] = {
+    [GIF_EXTENSION_BLOCK] = &read_extension_block,
+    [GIF_IMAGE_DESCRIPTOR_BLOCK] = &read_image_descriptor_block,
+    [GIF_TAIL_BLOCK] = &read_tail_block,
+};
 
-  size_t frame_index = 0;
-  bool seen_graphics_control_extension = false;
-  while (1) {
-    uint8_t block_type_byte;
-    if (!read_byte(state->current, state->remaining, &block_type_byte)) {
-      return GIF_READ_PAST_BUFFER;
+gif_result_code gif_parse_impl(gif_parse_state* const state)
+{
+  TRY(read_header(state));
+
+  while (!state->reached_tail) {
+    REQUIRE_REMAINING(1U);
+
+    assert(state->block_offsets == NULL
+           || state->base + state->block_offsets[state->block_index]
+               == state->current);
+    const gif_block_handler handler =
+        block_handlers[read_byte_un(&state->current)];
+    if (handler == NULL) {
+      return GIF_UNKNOWN_BLOCK;
     }
 
-    const gif_block_type block_type = (gif_block_type)block_type_byte;
-    switch (block_type) {
-      case GIF_EXTENSION_BLOCK: {
-        TRY(read_extension_block(
-            state, frame_index, &seen_graphics_control_extension));
-        break;
-      }
-      case GIF_IMAGE_DESCRIPTOR_BLOCK: {
-        TRY(read_image_descriptor_block(state, frame_index));
-        ++frame_index;
-        seen_graphics_control_extension = false;
-        break;
-      }
-      case GIF_TAIL_BLOCK:
-        if (frame_index == 0) {
-          return GIF_IMAGE_DESCRIPTOR_MISSING;
-        }
-        goto tail_block;
-      default:
-        return GIF_UNKNOWN_BLOCK;
-    }
+    TRY(handler(state));
+    ++state->block_index;
   }
 
-tail_block:;
   _Static_assert(sizeof(void*) >= sizeof(size_t),
                  "void* should have a size greater than or equal to size_t");
-  memcpy(&state->data, state->remaining, sizeof(size_t));
+  const size_t leftover_bytes = state->source == NULL
+      ? remaining(state)
+      : (size_t)(state->source->size - current_offset(state));
+  memcpy(&state->data, &leftover_bytes, sizeof(size_t));
 
   return GIF_SUCCESS;
 }
@@ -3,4 +3,10 @@
 #include "gif_engine/result_code.h"
 #include "parse/parse_state.h"
 
+typedef enum gif_block_type {
+  GIF_EXTENSION_BLOCK = 0x21,
+  GIF_IMAGE_DESCRIPTOR_BLOCK = 0x2C,
+  GIF_TAIL_BLOCK = 0x3B,
+} gif_block_type;
+
 gif_result_code gif_parse_impl(gif_parse_state* state);
@@ -1,15 +1,67 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "gif_engine/gif_engine.h"
 
+/**
+ * Size of the window ::gif_parse_source reads the file through. It must hold
+ * the largest record the parser bounds checks at once, which is a local color
+ * table followed by two bytes.
+ */
+#define GIF_PARSE_WINDOW_SIZE 16384U
+
+/**
+ * The parser works on a cursor and an end pointer held directly in this
+ * struct, which lives on the stack of ::gif_parse. Every fixed-size record is
+ * bounds checked once against \c end and then read without further checks.
+ *
+ * When parsing from a source, the cursor moves through a window that is
+ * refilled from the source whenever a record does not fit in what is left of
+ * it, so pointers into the window are only valid until the next bounds check.
+ */
 typedef struct gif_parse_state {
-  const uint8_t** current;
-  size_t* remaining;
+  const uint8_t* current;
+  const uint8_t* end;
+
+  /* The start of the buffer or window and its offset in the file */
+  const uint8_t* base;
+  uint64_t base_offset;
+
+  const gif_source* source;
+  uint8_t* window;
 
   gif_details* details;
   gif_allocator allocator;
+  size_t memory_used;
+
+  /* If not NULL, then color tables are taken from the pool of this context */
+  gif_context* context;
+
+  /* If not NULL, then the offset of every block in the buffer, as found by
+   * ::gif_parse_parallel_impl. The image data of frames is skipped over using
+   * these and hashed after the parse */
+  const size_t* block_offsets;
+  size_t block_index;
+
+  size_t frame_index;
+  size_t stop_after_frames;
+  bool keep_application_extensions;
+  bool seen_graphics_control_extension;
+  bool reached_tail;
 
   void* data;
 } gif_parse_state;
+
+/**
+ * Checks whether allocating \c extra bytes would push the memory used by the
+ * parser over the limit.
+ */
+static inline bool exceeds_memory_limit(const gif_parse_state* const state,
+                                        const size_t extra)
+{
+  const size_t limit = state->details->limits.max_memory;
+  return limit != 0
+      && (state->memory_used > limit || extra > limit - state->memory_used);
+}
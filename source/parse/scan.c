@@ -0,0 +1,455 @@
+#include "parse/scan.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "binary_literal.h"
+#include "buffer_ops.h"
+#include "hash.h"
+#include "parse/parse.h"
+#include "try.h"
+
+/* Distance between the points at which a speculative walk is compared with
+ * the real one. Shorter distances resynchronize sooner, but take more memory */
+#define SCAN_SAMPLE_DISTANCE 4096U
+
+#define SCAN_TASKS_PER_WORKER 4U
+
+/* Blocks are assumed to be at least this long on average when sizing the
+ * block arrays of the workers. Workers stop early on denser files and the
+ * sequential pass walks the rest */
+#define SCAN_BLOCK_DISTANCE 64U
+
+/* The header and the logical screen descriptor */
+#define SCAN_HEADER_SIZE 13U
+
+typedef enum scan_state {
+  /* At the byte introducing a block */
+  SCAN_BLOCK,
+  /* At the length byte of a sub-block */
+  SCAN_CHAIN,
+  /* At the length byte of the first sub-block of image data, which must not
+   * be the terminator */
+  SCAN_FIRST_SUBBLOCK,
+  /* Right after the tail block */
+  SCAN_TAIL,
+  SCAN_INVALID,
+} scan_state;
+
+/**
+ * A point of a walk over the block structure. Walks are deterministic, so two
+ * walks reaching equal cursors are the same walk from then on.
+ */
+typedef struct scan_cursor {
+  size_t position;
+  scan_state state;
+} scan_cursor;
+
+static bool cursor_equals(const scan_cursor left, const scan_cursor right)
+{
+  return left.position == right.position && left.state == right.state;
+}
+
+static scan_cursor scan_to(const size_t position,
+                           const scan_state state,
+                           const size_t size)
+{
+  /* Every state but the tail reads the byte at its position */
+  return (scan_cursor) {position, position < size ? state : SCAN_INVALID};
+}
+
+/**
+ * Moves \c cursor over a single record. A cursor becomes invalid exactly when
+ * ::gif_parse_impl would fail to bounds check the same record.
+ */
+static scan_cursor scan_step(const uint8_t* const bytes,
+                             const size_t size,
+                             const scan_cursor cursor)
+{
+  const size_t position = cursor.position;
+  switch (cursor.state) {
+    case SCAN_BLOCK:
+      switch (bytes[position]) {
+        case GIF_EXTENSION_BLOCK:
+          /* Past the label, every extension is a chain of sub-blocks */
+          return scan_to(position + 2U, SCAN_CHAIN, size);
+        case GIF_IMAGE_DESCRIPTOR_BLOCK: {
+          if (position + 9U >= size) {
+            break;
+          }
+
+          /* The descriptor, the color table and the minimum code size */
+          const uint8_t packed_byte = bytes[position + 9U];
+          const size_t color_table_size = (packed_byte & B8(10000000)) != 0
+              ? color_table_byte_size(packed_byte & B8(00000111))
+              : 0;
+          return scan_to(position + 11U + color_table_size,
+                         SCAN_FIRST_SUBBLOCK,
+                         size);
+        }
+        case GIF_TAIL_BLOCK:
+          return (scan_cursor) {position + 1U, SCAN_TAIL};
+        default:
+          break;
+      }
+      break;
+    case SCAN_FIRST_SUBBLOCK:
+      if (bytes[position] == 0) {
+        break;
+      }
+      /* fallthrough */
+    case SCAN_CHAIN: {
+      const uint8_t subblock_size = bytes[position];
+      return subblock_size == 0
+          ? scan_to(position + 1U, SCAN_BLOCK, size)
+          : scan_to(position + 1U + subblock_size, SCAN_CHAIN, size);
+    }
+    case SCAN_TAIL:
+    case SCAN_INVALID:
+      break;
+  }
+
+  return (scan_cursor) {position, SCAN_INVALID};
+}
+
+typedef struct scan_chunk {
+  /* The blocks found by the last attempt of the worker, in order */
+  size_t* blocks;
+  size_t block_count;
+
+  /* Where the worker stopped, which is never recorded itself */
+  scan_cursor exit;
+} scan_chunk;
+
+typedef struct scan_job {
+  const uint8_t* bytes;
+  size_t size;
+  size_t chunk_size;
+  size_t block_capacity;
+  size_t* blocks;
+  scan_chunk* chunks;
+
+  /* The first cursor of a walk past each multiple of the sample distance */
+  scan_cursor* samples;
+} scan_job;
+
+static void clear_samples(const scan_job* const job,
+                          const size_t first,
+                          const size_t last)
+{
+  for (size_t i = first; i < last; ++i) {
+    job->samples[i].state = SCAN_INVALID;
+  }
+}
+
+/**
+ * Walks a chunk of the buffer as if it started at the length byte of a
+ * sub-block. When the walk turns out to be impossible, its blocks and samples
+ * are dropped and the walk starts over right after the record that failed.
+ */
+static void speculate_chunk(void* const context, const size_t index)
+{
+  const scan_job* const job = context;
+  scan_chunk* const chunk = &job->chunks[index];
+  const size_t start = index * job->chunk_size;
+  const size_t end = start + job->chunk_size < job->size
+      ? start + job->chunk_size
+      : job->size;
+  const size_t last_sample =
+      (end + SCAN_SAMPLE_DISTANCE - 1U) / SCAN_SAMPLE_DISTANCE;
+
+  chunk->blocks = &job->blocks[index * job->block_capacity];
+  chunk->block_count = 0;
+  clear_samples(job, start / SCAN_SAMPLE_DISTANCE, last_sample);
+
+  scan_cursor cursor = {start, SCAN_CHAIN};
+  size_t first_sample = start / SCAN_SAMPLE_DISTANCE;
+  size_t next_sample = first_sample;
+  while (cursor.state != SCAN_TAIL && cursor.position < end) {
+    if (cursor.state == SCAN_BLOCK) {
+      if (chunk->block_count == job->block_capacity) {
+        break;
+      }
+      chunk->blocks[chunk->block_count++] = cursor.position;
+    }
+
+    const size_t sample = cursor.position / SCAN_SAMPLE_DISTANCE;
+    if (sample >= next_sample) {
+      job->samples[sample] = cursor;
+      next_sample = sample + 1U;
+    }
+
+    const scan_cursor next = scan_step(job->bytes, job->size, cursor);
+    if (next.state != SCAN_INVALID) {
+      cursor = next;
+      continue;
+    }
+
+    clear_samples(job, first_sample, next_sample);
+    chunk->block_count = 0;
+    cursor = (scan_cursor) {cursor.position + 1U, SCAN_CHAIN};
+    first_sample = cursor.position / SCAN_SAMPLE_DISTANCE;
+    next_sample = first_sample;
+  }
+
+  chunk->exit = cursor;
+}
+
+typedef struct block_list {
+  size_t* offsets;
+  size_t size;
+  size_t capacity;
+} block_list;
+
+/**
+ * Grows \c list to fit \c count more blocks. The list is left as it was on
+ * failure and has to be freed by the caller.
+ */
+static gif_result_code reserve_blocks(gif_parse_state* const state,
+                                      block_list* const list,
+                                      const size_t count)
+{
+  if (count <= list->capacity - list->size) {
+    return GIF_SUCCESS;
+  }
+
+  size_t capacity = list->capacity == 0 ? 64U : list->capacity * 2U;
+  while (capacity - list->size < count) {
+    capacity *= 2U;
+  }
+
+  const size_t growth = (capacity - list->capacity) * sizeof(size_t);
+  if (exceeds_memory_limit(state, growth)) {
+    return GIF_MEMORY_LIMIT_EXCEEDED;
+  }
+
+  size_t* const offsets =
+      state->allocator(list->offsets, capacity * sizeof(size_t));
+  if (offsets == NULL) {
+    return GIF_ALLOC_FAIL;
+  }
+
+  state->memory_used += growth;
+  list->offsets = offsets;
+  list->capacity = capacity;
+  return GIF_SUCCESS;
+}
+
+/**
+ * Adopts the blocks a worker found from \c position onwards. Positions grow
+ * along a walk, so those are a suffix of its blocks.
+ */
+static gif_result_code adopt_blocks(gif_parse_state* const state,
+                                    block_list* const list,
+                                    const scan_chunk* const chunk,
+                                    const size_t position)
+{
+  size_t low = 0;
+  size_t high = chunk->block_count;
+  while (low < high) {
+    const size_t middle = low + (high - low) / 2U;
+    if (chunk->blocks[middle] < position) {
+      low = middle + 1U;
+    } else {
+      high = middle;
+    }
+  }
+
+  const size_t count = chunk->block_count - low;
+  TRY(reserve_blocks(state, list, count));
+  memcpy(&list->offsets[list->size],
+         &chunk->blocks[low],
+         count * sizeof(size_t));
+  list->size += count;
+  return GIF_SUCCESS;
+}
+
+/**
+ * Walks the real block structure from \c first_block and collects the offset
+ * of every block into \c list, jumping to where a worker stopped whenever the
+ * walk meets a sample of that worker. \c is_valid is cleared if the walk
+ * fails before the tail block.
+ */
+static gif_result_code stitch_blocks(gif_parse_state* const state,
+                                     const scan_job* const job,
+                                     const size_t first_block,
+                                     block_list* const list,
+                                     bool* const is_valid)
+{
+  scan_cursor cursor = scan_to(first_block, SCAN_BLOCK, job->size);
+  size_t next_sample = 0;
+  while (cursor.state != SCAN_TAIL) {
+    if (cursor.state == SCAN_INVALID) {
+      *is_valid = false;
+      return GIF_SUCCESS;
+    }
+
+    const size_t sample = cursor.position / SCAN_SAMPLE_DISTANCE;
+    if (sample >= next_sample) {
+      next_sample = sample + 1U;
+      if (cursor_equals(cursor, job->samples[sample])) {
+        const scan_chunk* const chunk =
+            &job->chunks[cursor.position / job->chunk_size];
+        TRY(adopt_blocks(state, list, chunk, cursor.position));
+        cursor = chunk->exit;
+        continue;
+      }
+    }
+
+    if (cursor.state == SCAN_BLOCK) {
+      TRY(reserve_blocks(state, list, 1U));
+      list->offsets[list->size++] = cursor.position;
+    }
+
+    cursor = scan_step(job->bytes, job->size, cursor);
+  }
+
+  *is_valid = true;
+  return GIF_SUCCESS;
+}
+
+static bool find_first_block(const uint8_t* const bytes,
+                             const size_t size,
+                             size_t* const first_block)
+{
+  if (size < SCAN_HEADER_SIZE) {
+    return false;
+  }
+
+  const uint8_t packed_byte = bytes[10];
+  *first_block = SCAN_HEADER_SIZE
+      + ((packed_byte & B8(10000000)) != 0
+             ? color_table_byte_size(packed_byte & B8(00000111))
+             : 0);
+  return true;
+}
+
+/**
+ * Finds the offsets of all blocks in the buffer of \c state. \c list is left
+ * empty if the file has to be parsed sequentially. The scratch memory and the
+ * list count towards the memory limit of the parse.
+ */
+static gif_result_code scan_blocks(gif_parse_state* const state,
+                                   const gif_executor* const executor,
+                                   const gif_deallocator deallocator,
+                                   block_list* const list)
+{
+  const uint8_t* const bytes = state->base;
+  const size_t size = (size_t)(state->end - state->base);
+  size_t first_block = 0;
+  if (!find_first_block(bytes, size, &first_block)) {
+    return GIF_SUCCESS;
+  }
+
+  const size_t task_count = executor->worker_count * SCAN_TASKS_PER_WORKER;
+  const size_t chunk_samples =
+      (size / task_count + SCAN_SAMPLE_DISTANCE) / SCAN_SAMPLE_DISTANCE;
+  const size_t chunk_size = chunk_samples * SCAN_SAMPLE_DISTANCE;
+  const size_t chunk_count = (size + chunk_size - 1U) / chunk_size;
+  const size_t sample_count =
+      (size + SCAN_SAMPLE_DISTANCE - 1U) / SCAN_SAMPLE_DISTANCE;
+  const size_t block_capacity = chunk_size / SCAN_BLOCK_DISTANCE + 16U;
+
+  /* The chunks, the samples and the block arrays in a single allocation */
+  const size_t chunks_bytes = chunk_count * sizeof(scan_chunk);
+  const size_t samples_bytes = sample_count * sizeof(scan_cursor);
+  const size_t blocks_bytes = chunk_count * block_capacity * sizeof(size_t);
+  const size_t scratch_bytes = chunks_bytes + samples_bytes + blocks_bytes;
+  if (exceeds_memory_limit(state, scratch_bytes)) {
+    return GIF_MEMORY_LIMIT_EXCEEDED;
+  }
+
+  uint8_t* const scratch = state->allocator(NULL, scratch_bytes);
+  if (scratch == NULL) {
+    return GIF_ALLOC_FAIL;
+  }
+
+  state->memory_used += scratch_bytes;
+
+  scan_job job = {
+      .bytes = bytes,
+      .size = size,
+      .chunk_size = chunk_size,
+      .block_capacity = block_capacity,
+      .blocks = (size_t*)&scratch[chunks_bytes + samples_bytes],
+      .chunks = (scan_chunk*)scratch,
+      .samples = (scan_cursor*)&scratch[chunks_bytes],
+  };
+  executor->run(executor->context, &speculate_chunk, &job, chunk_count);
+
+  bool is_valid = false;
+  const gif_result_code code =
+      stitch_blocks(state, &job, first_block, list, &is_valid);
+  deallocator(scratch);
+  if (code != GIF_SUCCESS || !is_valid) {
+    deallocator(list->offsets);
+    *list = (block_list) {0};
+  }
+
+  return code;
+}
+
+typedef struct hash_job {
+  gif_frame_data* frames;
+  size_t frame_count;
+  size_t task_count;
+} hash_job;
+
+/**
+ * Walks the image data of a range of frames to finish the fingerprints
+ * started by the parser, in the same order the parser hashes them.
+ */
+static void hash_frames(void* const context, const size_t index)
+{
+  const hash_job* const job = context;
+  const size_t first = index * job->frame_count / job->task_count;
+  const size_t last = (index + 1U) * job->frame_count / job->task_count;
+  for (size_t i = first; i < last; ++i) {
+    gif_frame_data* const frame = &job->frames[i];
+    const uint8_t* current = frame->first_subblock - 1;
+    uint64_t fingerprint = frame->fingerprint;
+    size_t data_length = 0;
+    while (1) {
+      const uint8_t subblock_size = read_byte_un(&current);
+      if (subblock_size == 0) {
+        break;
+      }
+
+      fingerprint = hash_bytes(fingerprint, current, subblock_size);
+      current += subblock_size;
+      data_length += subblock_size;
+    }
+
+    frame->fingerprint = fingerprint;
+    frame->data_length = data_length;
+  }
+}
+
+gif_result_code gif_parse_parallel_impl(gif_parse_state* const state,
+                                        const gif_executor* const executor,
+                                        const gif_deallocator deallocator)
+{
+  block_list list = {0};
+  TRY(scan_blocks(state, executor, deallocator, &list));
+  if (list.offsets == NULL) {
+    return gif_parse_impl(state);
+  }
+
+  state->block_offsets = list.offsets;
+  const gif_result_code code = gif_parse_impl(state);
+  state->block_offsets = NULL;
+  deallocator(list.offsets);
+  TRY(code);
+
+  const gif_frame_vector* const frame_vector = &state->details->frame_vector;
+  const size_t max_tasks = executor->worker_count * SCAN_TASKS_PER_WORKER;
+  hash_job job = {
+      .frames = frame_vector->frames,
+      .frame_count = frame_vector->size,
+      .task_count =
+          frame_vector->size < max_tasks ? frame_vector->size : max_tasks,
+  };
+  executor->run(executor->context, &hash_frames, &job, job.task_count);
+  return GIF_SUCCESS;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "gif_engine/gif_engine.h"
+#include "gif_engine/result_code.h"
+#include "parse/parse_state.h"
+
+/**
+ * Buffers smaller than this are parsed sequentially even if an executor is
+ * given, because a single core walks them faster than the tasks start up.
+ */
+#define GIF_PARALLEL_SCAN_MIN_SIZE (1024U * 1024U)
+
+/**
+ * Same as ::gif_parse_impl for a state over a buffer, but the block structure
+ * of the file is scanned by the workers of \c executor first, and the image
+ * data of the frames is hashed by them afterwards. Scratch memory comes from
+ * the allocator of \c state, counts towards its memory limit and is returned
+ * to \c deallocator.
+ *
+ * Each worker speculates that its part of the buffer starts at the length
+ * byte of a sub-block. A sequential pass from the real first block then only
+ * has to walk until it meets one of those guesses, after which it adopts the
+ * blocks found by that worker. Anything out of the ordinary, like a truncated
+ * chain, falls back to ::gif_parse_impl, so the results are always the same.
+ */
+gif_result_code gif_parse_parallel_impl(gif_parse_state* state,
+                                        const gif_executor* executor,
+                                        gif_deallocator deallocator);
@@ -0,0 +1,185 @@
+#include "simd/simd.h"
+
+#include <string.h>
+
+/* Every MSVC compatible compiler, including clang-cl, declares __cpuid and
+ * _xgetbv in this header */
+#if defined(_MSC_VER)
+#  if defined(__has_include)
+#    if __has_include(<intrin.h>)
+#      include <intrin.h>
+#      define SIMD_HAS_CPUID
+#    endif
+#  else
+#    include <intrin.h>
+#    define SIMD_HAS_CPUID
+#  endif
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+typedef volatile long simd_level_slot;
+#  define SIMD_LOAD(slot) _InterlockedOr(&(slot), 0)
+#  define SIMD_STORE(slot, value) _InterlockedExchange(&(slot), (long)(value))
+#else
+#  include <stdatomic.h>
+typedef atomic_int simd_level_slot;
+/* The levels index into constant tables, so no ordering is needed */
+#  define SIMD_LOAD(slot) atomic_load_explicit(&(slot), memory_order_relaxed)
+#  define SIMD_STORE(slot, value) \
+    atomic_store_explicit(&(slot), (int)(value), memory_order_relaxed)
+#endif
+
+#define SIMD_LEVEL_UNKNOWN (-1)
+
+void simd_expand_scalar(uint8_t* const destination,
+                        const uint8_t* const indices,
+                        const size_t count,
+                        const uint32_t* const colors)
+{
+  for (size_t i = 0; i < count; ++i) {
+    memcpy(&destination[i * sizeof(uint32_t)],
+           &colors[indices[i]],
+           sizeof(uint32_t));
+  }
+}
+
+void simd_blend_scalar(uint8_t* const destination,
+                       const uint8_t* const indices,
+                       const size_t count,
+                       const uint32_t* const colors,
+                       const uint8_t transparent_index)
+{
+  for (size_t i = 0; i < count; ++i) {
+    uint8_t* const out = &destination[i * sizeof(uint32_t)];
+    uint32_t old;
+    memcpy(&old, out, sizeof(old));
+    const uint32_t mask = 0U - (uint32_t)(indices[i] == transparent_index);
+    const uint32_t pixel = (old & mask) | (colors[indices[i]] & ~mask);
+    memcpy(out, &pixel, sizeof(pixel));
+  }
+}
+
+void simd_unpack_scalar(uint32_t* const destination,
+                        const uint8_t* const source,
+                        const size_t count)
+{
+  for (size_t i = 0; i < count; ++i) {
+    const uint8_t* const color = &source[i * 3U];
+    destination[i] = (uint32_t)color[0] << 16U | (uint32_t)color[1] << 8U
+        | (uint32_t)color[2];
+  }
+}
+
+static const simd_kernels scalar_kernels = {
+    .expand = simd_expand_scalar,
+    .blend = simd_blend_scalar,
+    .unpack_colors = simd_unpack_scalar,
+};
+
+static const simd_kernels* const kernels_by_level[] = {
+    [GIF_SIMD_LEVEL_SCALAR] = &scalar_kernels,
+#ifdef SIMD_X86
+    [GIF_SIMD_LEVEL_SSE2] = &simd_sse2_kernels,
+    [GIF_SIMD_LEVEL_SSE4] = &simd_sse4_kernels,
+    [GIF_SIMD_LEVEL_AVX2] = &simd_avx2_kernels,
+    [GIF_SIMD_LEVEL_AVX512] = &simd_avx512_kernels,
+#endif
+};
+
+/* clang-cl only lets _xgetbv be called from code targeting XSAVE */
+#if defined(SIMD_X86) && !defined(__GNUC__) && defined(SIMD_HAS_CPUID)
+SIMD_TARGET("xsave")
+#endif
+static gif_simd_level detect_level(void)
+{
+#if defined(SIMD_X86) && defined(__GNUC__)
+  /* The builtins also check that the OS saves the AVX registers */
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+  {
+    return GIF_SIMD_LEVEL_AVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return GIF_SIMD_LEVEL_AVX2;
+  }
+  if (__builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("ssse3")) {
+    return GIF_SIMD_LEVEL_SSE4;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return GIF_SIMD_LEVEL_SSE2;
+  }
+#elif defined(SIMD_X86) && defined(SIMD_HAS_CPUID)
+  int info[4];
+  __cpuid(info, 0);
+  const int max_leaf = info[0];
+  __cpuid(info, 1);
+  const int has_sse2 = info[3] & (1 << 26);
+  const int ssse3_and_sse41 = (1 << 9) | (1 << 19);
+  const int has_sse4 = (info[2] & ssse3_and_sse41) == ssse3_and_sse41;
+  const int osxsave_and_avx = (1 << 27) | (1 << 28);
+  if ((info[2] & osxsave_and_avx) == osxsave_and_avx && max_leaf >= 7) {
+    /* The OS has to save the YMM registers for AVX2, and the opmask and ZMM
+     * registers as well for AVX-512 */
+    const unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    const int avx512f_and_bw = (1 << 16) | (1 << 30);
+    if ((xcr0 & 0xE6U) == 0xE6U
+        && (info[1] & avx512f_and_bw) == avx512f_and_bw)
+    {
+      return GIF_SIMD_LEVEL_AVX512;
+    }
+    if ((xcr0 & 6U) == 6U && (info[1] & (1 << 5)) != 0) {
+      return GIF_SIMD_LEVEL_AVX2;
+    }
+  }
+  if (has_sse4) {
+    return GIF_SIMD_LEVEL_SSE4;
+  }
+  if (has_sse2 != 0) {
+    return GIF_SIMD_LEVEL_SSE2;
+  }
+#endif
+
+  return GIF_SIMD_LEVEL_SCALAR;
+}
+
+static simd_level_slot supported_level = SIMD_LEVEL_UNKNOWN;
+static simd_level_slot active_level = SIMD_LEVEL_UNKNOWN;
+
+gif_simd_level gif_simd_level_supported_impl(void)
+{
+  /* Racing threads detect the same level, so storing it twice is harmless */
+  int level = (int)SIMD_LOAD(supported_level);
+  if (level == SIMD_LEVEL_UNKNOWN) {
+    level = (int)detect_level();
+    SIMD_STORE(supported_level, level);
+  }
+
+  return (gif_simd_level)level;
+}
+
+gif_simd_level gif_simd_level_active_impl(void)
+{
+  const int level = (int)SIMD_LOAD(active_level);
+  if (level != SIMD_LEVEL_UNKNOWN) {
+    return (gif_simd_level)level;
+  }
+
+  return gif_simd_level_supported_impl();
+}
+
+gif_result_code gif_simd_level_force_impl(const gif_simd_level level)
+{
+  if (level < GIF_SIMD_LEVEL_SCALAR || level > gif_simd_level_supported_impl())
+  {
+    return GIF_SIMD_LEVEL_UNSUPPORTED;
+  }
+
+  SIMD_STORE(active_level, level);
+  return GIF_SUCCESS;
+}
+
+const simd_kernels* simd_kernels_get(void)
+{
+  return kernels_by_level[gif_simd_level_active_impl()];
+}
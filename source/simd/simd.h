@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gif_engine/gif_engine.h"
+
+/* Other compilers might not accept the intrinsics of instruction sets that
+ * are not enabled for the whole translation unit, so they get the scalar
+ * kernels only */
+#if (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) \
+     || defined(_M_IX86)) \
+    && (defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER))
+#  define SIMD_X86
+#endif
+
+/* Kernels for levels above the baseline are compiled for their instruction
+ * set regardless of the flags of the translation unit and are only ever
+ * called after the CPU was found to support them. MSVC needs no attribute for
+ * that, but clang-cl does, even though it does not define __GNUC__ */
+#if defined(__GNUC__) || defined(__clang__)
+#  define SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#  define SIMD_TARGET(isa)
+#endif
+
+/**
+ * Writes the 4 byte colors of \c count palette indices to \c destination.
+ */
+typedef void (*simd_expand_function)(uint8_t* destination,
+                                     const uint8_t* indices,
+                                     size_t count,
+                                     const uint32_t* colors);
+
+/**
+ * Same as ::simd_expand_function, but pixels with \c transparent_index are
+ * left untouched.
+ */
+typedef void (*simd_blend_function)(uint8_t* destination,
+                                    const uint8_t* indices,
+                                    size_t count,
+                                    const uint32_t* colors,
+                                    uint8_t transparent_index);
+
+/**
+ * Unpacks \c count 3 byte RGB colors to the \c 0x00RRGGBB format.
+ */
+typedef void (*simd_unpack_function)(uint32_t* destination,
+                                     const uint8_t* source,
+                                     size_t count);
+
+typedef struct simd_kernels {
+  simd_expand_function expand;
+  simd_blend_function blend;
+  simd_unpack_function unpack_colors;
+} simd_kernels;
+
+void simd_expand_scalar(uint8_t* destination,
+                        const uint8_t* indices,
+                        size_t count,
+                        const uint32_t* colors);
+
+void simd_blend_scalar(uint8_t* destination,
+                       const uint8_t* indices,
+                       size_t count,
+                       const uint32_t* colors,
+                       uint8_t transparent_index);
+
+void simd_unpack_scalar(uint32_t* destination,
+                        const uint8_t* source,
+                        size_t count);
+
+#ifdef SIMD_X86
+extern const simd_kernels simd_sse2_kernels;
+extern const simd_kernels simd_sse4_kernels;
+extern const simd_kernels simd_avx2_kernels;
+extern const simd_kernels simd_avx512_kernels;
+#endif
+
+/**
+ * Returns the kernels of the active level. The CPU is inspected on the first
+ * call only.
+ */
+const simd_kernels* simd_kernels_get(void);
+
+gif_simd_level gif_simd_level_supported_impl(void);
+
+gif_simd_level gif_simd_level_active_impl(void);
+
+gif_result_code gif_simd_level_force_impl(gif_simd_level level);
@@ -0,0 +1,336 @@
+#include "simd/simd.h"
+
+#ifdef SIMD_X86
+
+#  include <immintrin.h>
+#  include <string.h>
+
+/**
+ * Expands the pixels of \c indices in blocks of 16, then merges them with the
+ * destination using a mask built from comparing the indices to the
+ * transparent one. Blocks without any transparent pixel are stored as is and
+ * blocks with nothing but transparent pixels are skipped.
+ */
+SIMD_TARGET("sse2")
+static void blend_sse2(uint8_t* const destination,
+                       const uint8_t* const indices,
+                       const size_t count,
+                       const uint32_t* const colors,
+                       const uint8_t transparent_index)
+{
+  size_t i = 0;
+  const __m128i transparent = _mm_set1_epi8((char)transparent_index);
+  for (; i + 16U <= count; i += 16U) {
+    const __m128i block = _mm_loadu_si128((const __m128i*)&indices[i]);
+    const __m128i mask = _mm_cmpeq_epi8(block, transparent);
+    const int bits = _mm_movemask_epi8(mask);
+    if (bits == 0xFFFF) {
+      continue;
+    }
+
+    uint32_t expanded[16];
+    for (size_t j = 0; j < 16U; ++j) {
+      expanded[j] = colors[indices[i + j]];
+    }
+
+    uint8_t* const out = &destination[i * sizeof(uint32_t)];
+    if (bits == 0) {
+      memcpy(out, expanded, sizeof(expanded));
+      continue;
+    }
+
+    /* Widen the byte mask to one 32 bit lane per pixel */
+    const __m128i low = _mm_unpacklo_epi8(mask, mask);
+    const __m128i high = _mm_unpackhi_epi8(mask, mask);
+    const __m128i lanes[4] = {
+        _mm_unpacklo_epi16(low, low),
+        _mm_unpackhi_epi16(low, low),
+        _mm_unpacklo_epi16(high, high),
+        _mm_unpackhi_epi16(high, high),
+    };
+    for (size_t j = 0; j < 4U; ++j) {
+      __m128i* const target = (__m128i*)&out[j * 16U];
+      const __m128i old = _mm_loadu_si128(target);
+      const __m128i color = _mm_loadu_si128((const __m128i*)&expanded[j * 4U]);
+      _mm_storeu_si128(target,
+                       _mm_or_si128(_mm_and_si128(lanes[j], old),
+                                    _mm_andnot_si128(lanes[j], color)));
+    }
+  }
+
+  simd_blend_scalar(&destination[i * sizeof(uint32_t)],
+                    &indices[i],
+                    count - i,
+                    colors,
+                    transparent_index);
+}
+
+/* Without a byte shuffle SSE2 has nothing to offer over the scalar expansion
+ * and color table unpacking */
+const simd_kernels simd_sse2_kernels = {
+    .expand = simd_expand_scalar,
+    .blend = blend_sse2,
+    .unpack_colors = simd_unpack_scalar,
+};
+
+/**
+ * Same as ::blend_sse2, but the lane masks are sign extended from the byte
+ * mask and partially transparent lanes are merged with a single byte blend.
+ */
+SIMD_TARGET("sse4.1")
+static void blend_sse4(uint8_t* const destination,
+                       const uint8_t* const indices,
+                       const size_t count,
+                       const uint32_t* const colors,
+                       const uint8_t transparent_index)
+{
+  size_t i = 0;
+  const __m128i transparent = _mm_set1_epi8((char)transparent_index);
+  for (; i + 16U <= count; i += 16U) {
+    const __m128i block = _mm_loadu_si128((const __m128i*)&indices[i]);
+    const __m128i mask = _mm_cmpeq_epi8(block, transparent);
+    const int bits = _mm_movemask_epi8(mask);
+    if (bits == 0xFFFF) {
+      continue;
+    }
+
+    const __m128i lanes[4] = {
+        _mm_cvtepi8_epi32(mask),
+        _mm_cvtepi8_epi32(_mm_srli_si128(mask, 4)),
+        _mm_cvtepi8_epi32(_mm_srli_si128(mask, 8)),
+        _mm_cvtepi8_epi32(_mm_srli_si128(mask, 12)),
+    };
+    uint8_t* const out = &destination[i * sizeof(uint32_t)];
+    for (size_t j = 0; j < 4U; ++j) {
+      const int lane_bits = (bits >> (j * 4U)) & 0xF;
+      if (lane_bits == 0xF) {
+        continue;
+      }
+
+      const uint8_t* const lane = &indices[i + j * 4U];
+      const __m128i color = _mm_setr_epi32((int)colors[lane[0]],
+                                           (int)colors[lane[1]],
+                                           (int)colors[lane[2]],
+                                           (int)colors[lane[3]]);
+      __m128i* const target = (__m128i*)&out[j * 16U];
+      if (lane_bits == 0) {
+        _mm_storeu_si128(target, color);
+        continue;
+      }
+
+      const __m128i old = _mm_loadu_si128(target);
+      _mm_storeu_si128(target, _mm_blendv_epi8(color, old, lanes[j]));
+    }
+  }
+
+  simd_blend_scalar(&destination[i * sizeof(uint32_t)],
+                    &indices[i],
+                    count - i,
+                    colors,
+                    transparent_index);
+}
+
+/**
+ * Unpacks 4 colors at a time with a byte shuffle. Every load reads 16 bytes
+ * for the 12 it uses, so the loop stops early enough to stay in bounds.
+ */
+SIMD_TARGET("sse4.1")
+static void unpack_sse4(uint32_t* const destination,
+                        const uint8_t* const source,
+                        const size_t count)
+{
+  const __m128i order = _mm_setr_epi8(
+      2, 1, 0, -128, 5, 4, 3, -128, 8, 7, 6, -128, 11, 10, 9, -128);
+  size_t i = 0;
+  for (; i + 6U <= count; i += 4U) {
+    const __m128i bytes = _mm_loadu_si128((const __m128i*)&source[i * 3U]);
+    _mm_storeu_si128((__m128i*)&destination[i], _mm_shuffle_epi8(bytes, order));
+  }
+
+  simd_unpack_scalar(&destination[i], &source[i * 3U], count - i);
+}
+
+/* There is no gather before AVX2, so the palette lookups of the expansion
+ * stay scalar */
+const simd_kernels simd_sse4_kernels = {
+    .expand = simd_expand_scalar,
+    .blend = blend_sse4,
+    .unpack_colors = unpack_sse4,
+};
+
+/**
+ * Zero extends 8 indices to 32 bit lanes, ready to be used as gather offsets.
+ */
+SIMD_TARGET("avx2")
+static __m256i load_indices_avx2(const uint8_t* const indices)
+{
+  return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)indices));
+}
+
+SIMD_TARGET("avx2")
+static void expand_avx2(uint8_t* const destination,
+                        const uint8_t* const indices,
+                        const size_t count,
+                        const uint32_t* const colors)
+{
+  size_t i = 0;
+  for (; i + 8U <= count; i += 8U) {
+    const __m256i offsets = load_indices_avx2(&indices[i]);
+    const __m256i color =
+        _mm256_i32gather_epi32((const int*)colors, offsets, 4);
+    _mm256_storeu_si256((__m256i*)&destination[i * sizeof(uint32_t)], color);
+  }
+
+  simd_expand_scalar(
+      &destination[i * sizeof(uint32_t)], &indices[i], count - i, colors);
+}
+
+SIMD_TARGET("avx2")
+static void blend_avx2(uint8_t* const destination,
+                       const uint8_t* const indices,
+                       const size_t count,
+                       const uint32_t* const colors,
+                       const uint8_t transparent_index)
+{
+  size_t i = 0;
+  const __m256i transparent = _mm256_set1_epi32(transparent_index);
+  for (; i + 8U <= count; i += 8U) {
+    const __m256i offsets = load_indices_avx2(&indices[i]);
+    const __m256i mask = _mm256_cmpeq_epi32(offsets, transparent);
+    const int bits = _mm256_movemask_epi8(mask);
+    if (bits == -1) {
+      continue;
+    }
+
+    __m256i* const target = (__m256i*)&destination[i * sizeof(uint32_t)];
+    const __m256i color =
+        _mm256_i32gather_epi32((const int*)colors, offsets, 4);
+    if (bits == 0) {
+      _mm256_storeu_si256(target, color);
+      continue;
+    }
+
+    const __m256i old = _mm256_loadu_si256(target);
+    _mm256_storeu_si256(target, _mm256_blendv_epi8(color, old, mask));
+  }
+
+  simd_blend_scalar(&destination[i * sizeof(uint32_t)],
+                    &indices[i],
+                    count - i,
+                    colors,
+                    transparent_index);
+}
+
+/* Color tables hold 256 colors at most, so the SSE4 shuffle is as good as a
+ * wider one would be */
+const simd_kernels simd_avx2_kernels = {
+    .expand = expand_avx2,
+    .blend = blend_avx2,
+    .unpack_colors = unpack_sse4,
+};
+
+SIMD_TARGET("avx512f,avx512bw")
+static __m512i load_indices_avx512(const uint8_t* const indices)
+{
+  return _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)indices));
+}
+
+/* Without optimizations GCC defines the gathers as macros that pass the mask
+ * as unsigned to a builtin taking it as signed */
+#  if defined(__GNUC__) && !defined(__clang__)
+#    pragma GCC diagnostic push
+#    pragma GCC diagnostic ignored "-Wsign-conversion"
+#  endif
+
+SIMD_TARGET("avx512f,avx512bw")
+static void expand_avx512(uint8_t* const destination,
+                          const uint8_t* const indices,
+                          const size_t count,
+                          const uint32_t* const colors)
+{
+  size_t i = 0;
+  for (; i + 16U <= count; i += 16U) {
+    const __m512i offsets = load_indices_avx512(&indices[i]);
+    const __m512i color = _mm512_i32gather_epi32(offsets, colors, 4);
+    _mm512_storeu_si512(&destination[i * sizeof(uint32_t)], color);
+  }
+
+  simd_expand_scalar(
+      &destination[i * sizeof(uint32_t)], &indices[i], count - i, colors);
+}
+
+/**
+ * Only the opaque lanes are gathered and stored, so the transparent pixels
+ * need neither a load of the destination nor a blend.
+ */
+SIMD_TARGET("avx512f,avx512bw")
+static void blend_avx512(uint8_t* const destination,
+                         const uint8_t* const indices,
+                         const size_t count,
+                         const uint32_t* const colors,
+                         const uint8_t transparent_index)
+{
+  size_t i = 0;
+  const __m512i transparent = _mm512_set1_epi32(transparent_index);
+  for (; i + 16U <= count; i += 16U) {
+    const __m512i offsets = load_indices_avx512(&indices[i]);
+    const __mmask16 opaque = _mm512_cmpneq_epi32_mask(offsets, transparent);
+    if (opaque == 0) {
+      continue;
+    }
+
+    const __m512i color = _mm512_mask_i32gather_epi32(
+        _mm512_setzero_si512(), opaque, offsets, colors, 4);
+    _mm512_mask_storeu_epi32(
+        &destination[i * sizeof(uint32_t)], opaque, color);
+  }
+
+  simd_blend_scalar(&destination[i * sizeof(uint32_t)],
+                    &indices[i],
+                    count - i,
+                    colors,
+                    transparent_index);
+}
+
+#  if defined(__GNUC__) && !defined(__clang__)
+#    pragma GCC diagnostic pop
+#  endif
+
+/**
+ * Unpacks 16 colors at a time. The 48 bytes they take are spread over the 4
+ * lanes 12 bytes each, which the byte shuffle then unpacks lane by lane.
+ * Every load reads 64 bytes, so the loop stops early enough to stay in
+ * bounds.
+ */
+SIMD_TARGET("avx512f,avx512bw")
+static void unpack_avx512(uint32_t* const destination,
+                          const uint8_t* const source,
+                          const size_t count)
+{
+  const __m512i spread = _mm512_setr_epi32(
+      0, 1, 2, 0, 3, 4, 5, 0, 6, 7, 8, 0, 9, 10, 11, 0);
+  const __m512i order =
+      _mm512_broadcast_i32x4(_mm_setr_epi8(2, 1, 0, -128, 5, 4, 3, -128,
+                                           8, 7, 6, -128, 11, 10, 9, -128));
+  size_t i = 0;
+  for (; i + 22U <= count; i += 16U) {
+    const __m512i bytes = _mm512_permutexvar_epi32(
+        spread, _mm512_loadu_si512(&source[i * 3U]));
+    _mm512_storeu_si512(&destination[i], _mm512_shuffle_epi8(bytes, order));
+  }
+
+  simd_unpack_scalar(&destination[i], &source[i * 3U], count - i);
+}
+
+const simd_kernels simd_avx512_kernels = {
+    .expand = expand_avx512,
+    .blend = blend_avx512,
+    .unpack_colors = unpack_avx512,
+};
+
+#else
+
+/* ISO C does not allow empty translation units */
+typedef int simd_x86_unused;
+
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gif_engine/gif_engine.h"
+
+/**
+ * A read-write mapping of an anonymous temporary file. The file is removed by
+ * the OS once the mapping is gone, even if the process crashes.
+ */
+typedef struct spill_mapping {
+  uint8_t* pointer;
+  size_t size;
+  void* cleanup_data[2];
+} spill_mapping;
+
+/**
+ * Creates a temporary file of \c size bytes in \c directory, or in the default
+ * temporary directory of the OS if \c directory is \c NULL, and maps it into
+ * memory.
+ */
+gif_result_code spill_map(spill_mapping* mapping,
+                          size_t size,
+                          const char* directory);
+
+/**
+ * Hints to the OS that the pages fully inside the given range of the mapping
+ * will not be accessed for a while. The contents are kept in the file and are
+ * paged back in on the next access.
+ */
+void spill_release(const spill_mapping* mapping, size_t offset, size_t size);
+
+void spill_unmap(const spill_mapping* mapping);
@@ -0,0 +1,85 @@
+#include <Windows.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "spill/spill.h"
+
+gif_result_code spill_map(spill_mapping* const mapping,
+                          const size_t size,
+                          const char* const directory)
+{
+  char directory_buffer[MAX_PATH + 1];
+  const char* temp_directory = directory;
+  if (temp_directory == NULL) {
+    const DWORD length =
+        GetTempPathA(sizeof(directory_buffer), directory_buffer);
+    if (length == 0 || length > sizeof(directory_buffer)) {
+      return GIF_SPILL_FAIL;
+    }
+
+    temp_directory = directory_buffer;
+  }
+
+  char path[MAX_PATH];
+  if (GetTempFileNameA(temp_directory, "gif", 0, path) == 0) {
+    return GIF_SPILL_FAIL;
+  }
+
+  /* The file is deleted as soon as the last handle to it is closed, so
+   * nothing is left behind no matter how the process exits */
+  HANDLE file_handle = CreateFileA(
+      path,
+      GENERIC_READ | GENERIC_WRITE,
+      0,
+      NULL,
+      CREATE_ALWAYS,
+      FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+      NULL);
+  if (file_handle == INVALID_HANDLE_VALUE) {
+    DeleteFileA(path);
+    return GIF_SPILL_FAIL;
+  }
+
+  const uint64_t size64 = size;
+  HANDLE mapping_handle = CreateFileMappingA(file_handle,
+                                             NULL,
+                                             PAGE_READWRITE,
+                                             (DWORD)(size64 >> 32U),
+                                             (DWORD)size64,
+                                             NULL);
+  if (mapping_handle == NULL) {
+    CloseHandle(file_handle);
+    return GIF_SPILL_FAIL;
+  }
+
+  void* pointer =
+      MapViewOfFile(mapping_handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+  if (pointer == NULL) {
+    CloseHandle(mapping_handle);
+    CloseHandle(file_handle);
+    return GIF_SPILL_FAIL;
+  }
+
+  *mapping = (spill_mapping) {
+      .pointer = pointer,
+      .size = size,
+      .cleanup_data = {mapping_handle, file_handle},
+  };
+  return GIF_SUCCESS;
+}
+
+void spill_release(const spill_mapping* const mapping,
+                   const size_t offset,
+                   const size_t size)
+{
+  /* Unlocking pages that are not locked removes them from the working set,
+   * while the file keeps their contents */
+  VirtualUnlock(&mapping->pointer[offset], size);
+}
+
+void spill_unmap(const spill_mapping* const mapping)
+{
+  UnmapViewOfFile(mapping->pointer);
+  CloseHandle(mapping->cleanup_data[0]);
+  CloseHandle(mapping->cleanup_data[1]);
+}
@@ -0,0 +1,110 @@
+/* mkstemp, ftruncate and madvise are hidden in strict ISO C mode */
+#ifndef _DEFAULT_SOURCE
+#  define _DEFAULT_SOURCE
+#endif
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "spill/spill.h"
+
+#define SPILL_PATH_SIZE 4096U
+
+static const char spill_file_template[] = "/gif_engine.XXXXXX";
+
+static const char* default_directory(void)
+{
+  const char* const directory = getenv("TMPDIR");
+  return directory == NULL || directory[0] == '\0' ? "/tmp" : directory;
+}
+
+gif_result_code spill_map(spill_mapping* const mapping,
+                          const size_t size,
+                          const char* directory)
+{
+  if (directory == NULL) {
+    directory = default_directory();
+  }
+
+  char path[SPILL_PATH_SIZE];
+  const size_t directory_length = strlen(directory);
+  const off_t file_size = (off_t)size;
+  if (directory_length >= SPILL_PATH_SIZE - sizeof(spill_file_template)
+      || file_size < 0 || (size_t)file_size != size)
+  {
+    return GIF_SPILL_FAIL;
+  }
+
+  memcpy(path, directory, directory_length);
+  memcpy(&path[directory_length],
+         spill_file_template,
+         sizeof(spill_file_template));
+
+  const int file_descriptor = mkstemp(path);
+  if (file_descriptor == -1) {
+    return GIF_SPILL_FAIL;
+  }
+
+  /* The file lives on only as long as something refers to it, so nothing is
+   * left behind no matter how the process exits */
+  unlink(path);
+
+  void* pointer = MAP_FAILED;
+  if (ftruncate(file_descriptor, file_size) == 0) {
+    pointer = mmap(
+        NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor, 0);
+  }
+
+  /* The mapping keeps its own reference to the file */
+  close(file_descriptor);
+  if (pointer == MAP_FAILED) {
+    return GIF_SPILL_FAIL;
+  }
+
+  *mapping = (spill_mapping) {
+      .pointer = pointer,
+      .size = size,
+      .cleanup_data = {NULL, NULL},
+  };
+  return GIF_SUCCESS;
+}
+
+void spill_release(const spill_mapping* const mapping,
+                   const size_t offset,
+                   const size_t size)
+{
+#ifdef MADV_DONTNEED
+  const long page_size_value = sysconf(_SC_PAGESIZE);
+  if (page_size_value <= 0) {
+    return;
+  }
+
+  /* Only whole pages can be dropped */
+  const uintptr_t page_size = (uintptr_t)page_size_value;
+  const uintptr_t start = (uintptr_t)&mapping->pointer[offset];
+  const uintptr_t end = start + size;
+  const uintptr_t first_page = (start + page_size - 1U) & ~(page_size - 1U);
+  const uintptr_t last_page = end & ~(page_size - 1U);
+  if (first_page >= last_page) {
+    return;
+  }
+
+  /* Dirty pages of a shared file mapping stay in the file, so this only
+   * drops them from the resident set */
+  madvise((void*)first_page, last_page - first_page, MADV_DONTNEED);
+#else
+  (void)mapping;
+  (void)offset;
+  (void)size;
+#endif
+}
+
+void spill_unmap(const spill_mapping* const mapping)
+{
+  munmap(mapping->pointer, mapping->size);
+}
@@ -0,0 +1,90 @@
+#include "timeline/timeline.h"
+
+#include <stdint.h>
+
+/* Browsers treat delays this short as unset and show such frames for the
+ * replacement delay instead, otherwise a file could ask to be redrawn as fast
+ * as possible. Both values are in hundredths of a second. */
+#define TIMELINE_MIN_DELAY 2U
+#define TIMELINE_REPLACEMENT_DELAY 10U
+
+#define TIMELINE_MS_PER_DELAY_UNIT 10U
+
+static uint64_t frame_duration(const uint16_t delay)
+{
+  const uint64_t normalized =
+      delay < TIMELINE_MIN_DELAY ? TIMELINE_REPLACEMENT_DELAY : delay;
+  return normalized * TIMELINE_MS_PER_DELAY_UNIT;
+}
+
+gif_result_code gif_timeline_build_impl(const gif_details* const details,
+                                        gif_timeline* const timeline,
+                                        const gif_allocator allocator)
+{
+  const gif_frame_vector* const frame_vector = &details->frame_vector;
+  const size_t size = frame_vector->size;
+  if (size == 0) {
+    return GIF_FRAME_DATA_EMPTY;
+  }
+
+  if (size > SIZE_MAX / sizeof(uint64_t)) {
+    return GIF_ALLOC_FAIL;
+  }
+
+  uint64_t* const frame_ends = allocator(NULL, sizeof(uint64_t) * size);
+  if (frame_ends == NULL) {
+    return GIF_ALLOC_FAIL;
+  }
+
+  /* Each frame adds less than 2^20 ms, so this cannot overflow with fewer
+   * than 2^44 frames */
+  uint64_t end = 0;
+  for (size_t i = 0; i < size; ++i) {
+    end += frame_duration(frame_vector->frames[i].graphic_extension.delay);
+    frame_ends[i] = end;
+  }
+
+  *timeline = (gif_timeline) {
+      .frame_ends = frame_ends,
+      .size = size,
+      .duration = end,
+      .repeat_count = details->repeat_count,
+      .has_loop_extension = details->has_loop_extension,
+  };
+  return GIF_SUCCESS;
+}
+
+size_t gif_timeline_frame_at_impl(const gif_timeline* const timeline,
+                                  uint64_t time)
+{
+  const size_t last = timeline->size - 1U;
+  const uint64_t duration = timeline->duration;
+  if (!timeline->has_loop_extension || timeline->repeat_count != 0) {
+    /* The animation is shown once and then repeated repeat_count times,
+     * after which the last frame stays on screen. Browsers do not repeat
+     * files without a loop extension at all. */
+    const uint64_t plays = timeline->has_loop_extension
+        ? (uint64_t)timeline->repeat_count + 1U
+        : 1U;
+    if (time / duration >= plays) {
+      return last;
+    }
+  }
+
+  time %= duration;
+
+  /* Finds the first frame that ends after time */
+  const uint64_t* const frame_ends = timeline->frame_ends;
+  size_t low = 0;
+  size_t high = last;
+  while (low < high) {
+    const size_t middle = low + (high - low) / 2U;
+    if (frame_ends[middle] <= time) {
+      low = middle + 1U;
+    } else {
+      high = middle;
+    }
+  }
+
+  return low;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "gif_engine/gif_engine.h"
+
+gif_result_code gif_timeline_build_impl(const gif_details* details,
+                                        gif_timeline* timeline,
+                                        gif_allocator allocator);
+
+size_t gif_timeline_frame_at_impl(const gif_timeline* timeline,
+                                  uint64_t time);
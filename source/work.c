@@ -0,0 +1,16 @@
+#include "work.h"
+
+#ifdef GIF_ENGINE_COUNT_WORK
+gif_work_counters gif_work;
+#endif
+
+gif_work_counters gif_work_take(void)
+{
+#ifdef GIF_ENGINE_COUNT_WORK
+  const gif_work_counters work = gif_work;
+  gif_work = (gif_work_counters) {0};
+  return work;
+#else
+  return (gif_work_counters) {0};
+#endif
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Work done by the decoder, as returned by ::gif_work_take.
+ */
+typedef struct gif_work_counters {
+  /** Codes read from LZW streams, clear and end codes included. */
+  uint64_t lzw_codes;
+
+  /** Pixels written to canvases, targets and index buffers. */
+  uint64_t pixels_written;
+} gif_work_counters;
+
+/**
+ * Adds \c amount to the \c counter member of the work counters. This expands
+ * to nothing unless the library is built with \c GIF_ENGINE_COUNT_WORK, so it
+ * can be used in the innermost loops.
+ */
+#ifdef GIF_ENGINE_COUNT_WORK
+extern gif_work_counters gif_work;
+#  define COUNT_WORK(counter, amount) ((void)(gif_work.counter += (amount)))
+#else
+#  define COUNT_WORK(counter, amount) ((void)0)
+#endif
+
+/**
+ * Returns the work done by the library since the last call and resets the
+ * counters. Work is only counted if the library was built with
+ * \c GIF_ENGINE_COUNT_WORK defined, which the decoder fuzzer does to catch
+ * inputs that cost far more than their size suggests. Otherwise this returns
+ * zeros.
+ *
+ * This is not part of the public API. The fuzzer links the static library and
+ * includes this header directly. The counters are plain globals, so they are
+ * only exact if a single thread uses the library, which is the case for the
+ * fuzzer and its serial executor.
+ */
+gif_work_counters gif_work_take(void);
@@ -0,0 +1,151 @@
+#include <gif_engine/gif_engine.hpp>
+#include <utest.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <utility>
+
+namespace
+{
+const std::uint8_t animation_gif[] = {
+    0x47, 0x49, 0x46, 0x38, 0x39, 0x61, 0x02, 0x00, 0x02, 0x00, 0x81, 0x00,
+    0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00, 0xFF, 0xFF,
+    0xFF, 0x21, 0xF9, 0x04, 0x04, 0x0A, 0x00, 0x00, 0x00, 0x2C, 0x00, 0x00,
+    0x00, 0x00, 0x02, 0x00, 0x02, 0x00, 0x00, 0x02, 0x03, 0x44, 0x34, 0x05,
+    0x00, 0x21, 0xF9, 0x04, 0x09, 0x0A, 0x00, 0x03, 0x00, 0x2C, 0x01, 0x00,
+    0x00, 0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x02, 0x02, 0xD4, 0x0A, 0x00,
+    0x21, 0xF9, 0x04, 0x05, 0x0A, 0x00, 0x03, 0x00, 0x2C, 0x01, 0x00, 0x00,
+    0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x02, 0x02, 0xD4, 0x0A, 0x00, 0x21,
+    0xF9, 0x04, 0x05, 0x0A, 0x00, 0x03, 0x00, 0x2C, 0x01, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x02, 0x00, 0x00, 0x02, 0x02, 0xD4, 0x0A, 0x00, 0x3B,
+};
+
+const std::uint8_t last_canvas[] = {
+    255, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 0,
+};
+
+/**
+ * Forwards to a monotonic buffer on the stack that has no upstream, so any
+ * allocation bypassing it would fail, and counts the live blocks.
+ */
+class counting_resource : public std::pmr::memory_resource
+{
+public:
+  std::size_t allocations = 0;
+  std::size_t live = 0;
+
+private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override
+  {
+    ++allocations;
+    ++live;
+    return buffer_.allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* pointer,
+                     std::size_t bytes,
+                     std::size_t alignment) override
+  {
+    --live;
+    buffer_.deallocate(pointer, bytes, alignment);
+  }
+
+  bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override
+  {
+    return this == &other;
+  }
+
+  std::array<std::byte, 16384> storage_ {};
+  std::pmr::monotonic_buffer_resource buffer_ {
+      storage_.data(), storage_.size(), std::pmr::null_memory_resource()};
+};
+}  // namespace
+
+UTEST(cpp, owning_types_use_resource)
+{
+  /* Arrange */
+  counting_resource resource;
+
+  /* Act */
+  {
+    gif::details parsed = gif::details::parse(
+        animation_gif, sizeof(animation_gif), nullptr, &resource);
+    gif::details moved = std::move(parsed);
+    gif::canvases decoded = gif::canvases::decode(moved, &resource);
+    gif::timeline timeline = gif::timeline::build(moved, &resource);
+
+    /* Assert */
+    ASSERT_EQ(moved.frames().size(), 4U);
+    ASSERT_EQ(moved.global_color_table().size(), 4U);
+    ASSERT_EQ(moved.global_color_table()[0], 0xFF0000U);
+    ASSERT_TRUE(gif::details::local_color_table(moved.frames()[0]).empty());
+    ASSERT_TRUE(parsed.frames().empty());
+
+    ASSERT_EQ(decoded.size(), 4U);
+    ASSERT_EQ(decoded.canvas_size(), sizeof(last_canvas));
+    ASSERT_EQ(
+        std::memcmp(decoded[3].data(), last_canvas, sizeof(last_canvas)), 0);
+
+    ASSERT_EQ(timeline.frame_at(0), 0U);
+    ASSERT_EQ(timeline.frame_at(timeline.get().duration - 1U), 3U);
+  }
+
+  ASSERT_GT(resource.allocations, 0U);
+  ASSERT_EQ(resource.live, 0U);
+}
+
+UTEST(cpp, errors_throw)
+{
+  /* Arrange */
+  const std::uint8_t not_a_gif[] = {'P', 'N', 'G'};
+  gif_result_code code = GIF_SUCCESS;
+
+  /* Act */
+  try {
+    gif::details::parse(not_a_gif, sizeof(not_a_gif));
+  } catch (const gif::error& error) {
+    code = error.code();
+  }
+
+  /* Assert */
+  ASSERT_EQ(static_cast<int>(code), GIF_NOT_A_GIF);
+}
+
+UTEST(cpp, context_reuses_memory)
+{
+  /* Arrange */
+  counting_resource resource;
+  gif::context context(&resource);
+
+  /* Act */
+  /* The color table pool grows to fit the first file when parsing the second
+   * one, so the third one is the first to parse without allocating */
+  for (int i = 0; i < 2; ++i) {
+    context.parse(animation_gif, sizeof(animation_gif));
+    context.decode();
+  }
+  std::size_t warm_allocations = resource.allocations;
+
+  const gif_details& parsed =
+      context.parse(animation_gif, sizeof(animation_gif));
+  gif::span<const std::uint8_t> canvases = context.decode();
+
+  /* Assert */
+  ASSERT_EQ(parsed.frame_vector.size, 4U);
+  ASSERT_EQ(canvases.size(), sizeof(last_canvas) * 4U);
+  ASSERT_EQ(std::memcmp(&canvases[sizeof(last_canvas) * 3U],
+                        last_canvas,
+                        sizeof(last_canvas)),
+            0);
+  ASSERT_EQ(resource.allocations, warm_allocations);
+
+  /* Cleanup */
+  context.trim();
+  ASSERT_EQ(resource.live, 0U);
+}
+
+UTEST_MAIN()
@@ -6,6 +6,7 @@
 #include <utest.h>
 
 #include "gif_mmap.h"
+#include "gif_stress.h"
 
 struct parser_fixture_2frame {
   gif_mmap_span span;
@@ -80,6 +81,7 @@ UTEST_F(parser_fixture_2frame, parse)
   ASSERT_EQ(global_color_table[1], BLUE);
 
   ASSERT_EQ(details.repeat_count, 1);
+  ASSERT_EQ(details.has_loop_extension, true);
 
   gif_frame_vector frame_vector = details.frame_vector;
   ASSERT_NE(frame_vector.frames, NULL);
@@ -139,10 +141,49 @@ UTEST_F(parser_fixture_2frame, parse)
   ASSERT_EQ(frame2.min_code_size, 0x11);
   ASSERT_EQ(frame2.data_length, 2U);
 
+  ASSERT_NE(frame1.fingerprint, frame2.fingerprint);
+
   /* Cleanup */
   gif_free_details(&details, &free);
 }
 
+UTEST_F(parser_fixture_2frame, timeline)
+{
+  /* Arrange */
+  gif_details details;
+  gif_parse_result parse_result = gif_parse(utest_fixture->span.pointer,
+                                            utest_fixture->span.size,
+                                            &details,
+                                            &realloc);
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+
+  /* Act */
+  gif_timeline timeline;
+  gif_result_code code = gif_timeline_build(&details, &timeline, &realloc);
+  gif_free_details(&details, &free);
+
+  /* Assert */
+  ASSERT_EQ((int)code, GIF_SUCCESS);
+
+  /* Delays of 6 and 96 hundredths of a second, played twice */
+  ASSERT_EQ(timeline.size, 2U);
+  ASSERT_EQ(timeline.frame_ends[0], 60U);
+  ASSERT_EQ(timeline.frame_ends[1], 1020U);
+  ASSERT_EQ(timeline.duration, 1020U);
+
+  ASSERT_EQ(gif_timeline_frame_at(&timeline, 0), 0U);
+  ASSERT_EQ(gif_timeline_frame_at(&timeline, 59), 0U);
+  ASSERT_EQ(gif_timeline_frame_at(&timeline, 60), 1U);
+  ASSERT_EQ(gif_timeline_frame_at(&timeline, 1019), 1U);
+  ASSERT_EQ(gif_timeline_frame_at(&timeline, 1020), 0U);
+  ASSERT_EQ(gif_timeline_frame_at(&timeline, 1080), 1U);
+  ASSERT_EQ(gif_timeline_frame_at(&timeline, 2040), 1U);
+  ASSERT_EQ(gif_timeline_frame_at(&timeline, 1000000), 1U);
+
+  /* Cleanup */
+  gif_timeline_free(&timeline, &free);
+}
+
 struct parser_fixture_11frame {
   gif_mmap_span span;
 };
@@ -199,4 +240,1544 @@ UTEST_F(parser_fixture_11frame, realloc_fail)
   ASSERT_EQ((int)parse_result.code, GIF_REALLOC_FAIL);
 }
 
+UTEST_F(parser_fixture_11frame, duplicate_fingerprints)
+{
+  /* Arrange */
+  gif_details details;
+
+  /* Act */
+  gif_parse_result parse_result = gif_parse(utest_fixture->span.pointer,
+                                            utest_fixture->span.size,
+                                            &details,
+                                            &realloc);
+
+  /* Assert */
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+
+  gif_frame_vector frame_vector = details.frame_vector;
+  ASSERT_EQ(frame_vector.size, 11U);
+  for (size_t i = 1; i < frame_vector.size; ++i) {
+    ASSERT_EQ(frame_vector.frames[i].fingerprint,
+              frame_vector.frames[0].fingerprint);
+  }
+
+  /* Cleanup */
+  gif_free_details(&details, &free);
+}
+
+UTEST_F(parser_fixture_2frame, verify_rejects_min_code_size)
+{
+  /* Arrange */
+  gif_details details;
+  gif_parse_result parse_result = gif_parse(utest_fixture->span.pointer,
+                                            utest_fixture->span.size,
+                                            &details,
+                                            &realloc);
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+
+  /* Act */
+  gif_frame_verify_result results[2];
+  gif_result_code code = gif_verify(&details, results);
+  gif_free_details(&details, &free);
+
+  /* Assert */
+  ASSERT_EQ((int)code, GIF_LZW_INVALID_MIN_CODE_SIZE);
+  ASSERT_EQ((int)results[0].code, GIF_LZW_INVALID_MIN_CODE_SIZE);
+  ASSERT_EQ((int)results[1].code, GIF_LZW_INVALID_MIN_CODE_SIZE);
+}
+
+/* A 3x3 GIF with three frames: one valid, one whose image data ends after 5
+ * pixels and one whose image data decodes to 12 pixels */
+static const uint8_t verify_gif[] = {
+    0x47, 0x49, 0x46, 0x38, 0x39, 0x61, 0x03, 0x00, 0x03, 0x00, 0x81, 0x00,
+    0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00, 0xFF, 0xFF,
+    0xFF, 0x2C, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x03, 0x00, 0x00, 0x02,
+    0x05, 0x44, 0x02, 0x32, 0x23, 0x50, 0x00, 0x2C, 0x00, 0x00, 0x00, 0x00,
+    0x03, 0x00, 0x03, 0x00, 0x00, 0x02, 0x03, 0x44, 0x02, 0x52, 0x00, 0x2C,
+    0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x03, 0x00, 0x00, 0x02, 0x06, 0x44,
+    0x02, 0x32, 0x23, 0x76, 0x05, 0x00, 0x3B,
+};
+
+UTEST(verify, frame_statuses)
+{
+  /* Arrange */
+  gif_details details;
+  gif_parse_result parse_result =
+      gif_parse(verify_gif, sizeof(verify_gif), &details, &realloc);
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+  ASSERT_EQ(details.frame_vector.size, 3U);
+
+  /* Act */
+  gif_frame_verify_result results[3];
+  gif_result_code code = gif_verify(&details, results);
+  gif_free_details(&details, &free);
+
+  /* Assert */
+  ASSERT_EQ((int)code, GIF_LZW_EARLY_END);
+
+  ASSERT_EQ((int)results[0].code, GIF_SUCCESS);
+  ASSERT_EQ(results[0].pixel_count, 9U);
+
+  ASSERT_EQ((int)results[1].code, GIF_LZW_EARLY_END);
+  ASSERT_EQ(results[1].pixel_count, 5U);
+
+  ASSERT_EQ((int)results[2].code, GIF_LZW_OUTPUT_OVERFLOW);
+  ASSERT_GT(results[2].pixel_count, 9U);
+}
+
+UTEST(timeline, replaces_unset_delays)
+{
+  /* Arrange */
+  gif_details details;
+  gif_parse_result parse_result =
+      gif_parse(verify_gif, sizeof(verify_gif), &details, &realloc);
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+
+  /* Act */
+  gif_timeline timeline;
+  gif_result_code code = gif_timeline_build(&details, &timeline, &realloc);
+  gif_free_details(&details, &free);
+
+  /* Assert */
+  ASSERT_EQ((int)code, GIF_SUCCESS);
+  ASSERT_EQ(timeline.frame_ends[0], 100U);
+  ASSERT_EQ(timeline.frame_ends[2], 300U);
+  ASSERT_EQ(gif_timeline_frame_at(&timeline, 150), 1U);
+
+  /* Cleanup */
+  gif_timeline_free(&timeline, &free);
+}
+
+/* The same frames as verify_gif, but looping forever */
+static const uint8_t looping_verify_gif[] = {
+    0x47, 0x49, 0x46, 0x38, 0x39, 0x61, 0x03, 0x00, 0x03, 0x00, 0x81, 0x00,
+    0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00, 0xFF, 0xFF,
+    0xFF, 0x21, 0xFF, 0x0B, 0x4E, 0x45, 0x54, 0x53, 0x43, 0x41, 0x50, 0x45,
+    0x32, 0x2E, 0x30, 0x03, 0x01, 0x00, 0x00, 0x00, 0x2C, 0x00, 0x00, 0x00,
+    0x00, 0x03, 0x00, 0x03, 0x00, 0x00, 0x02, 0x05, 0x44, 0x02, 0x32, 0x23,
+    0x50, 0x00, 0x2C, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x03, 0x00, 0x00,
+    0x02, 0x03, 0x44, 0x02, 0x52, 0x00, 0x2C, 0x00, 0x00, 0x00, 0x00, 0x03,
+    0x00, 0x03, 0x00, 0x00, 0x02, 0x06, 0x44, 0x02, 0x32, 0x23, 0x76, 0x05,
+    0x00, 0x3B,
+};
+
+UTEST(timeline, plays_once_without_loop_extension)
+{
+  /* Arrange */
+  gif_details once_details;
+  gif_parse_result once_result =
+      gif_parse(verify_gif, sizeof(verify_gif), &once_details, &realloc);
+  ASSERT_EQ((int)once_result.code, GIF_SUCCESS);
+
+  gif_details looping_details;
+  gif_parse_result looping_result = gif_parse(looping_verify_gif,
+                                              sizeof(looping_verify_gif),
+                                              &looping_details,
+                                              &realloc);
+  ASSERT_EQ((int)looping_result.code, GIF_SUCCESS);
+
+  /* Act */
+  gif_timeline once;
+  gif_result_code once_code =
+      gif_timeline_build(&once_details, &once, &realloc);
+  gif_free_details(&once_details, &free);
+
+  gif_timeline looping;
+  gif_result_code looping_code =
+      gif_timeline_build(&looping_details, &looping, &realloc);
+  gif_free_details(&looping_details, &free);
+
+  /* Assert */
+  ASSERT_EQ((int)once_code, GIF_SUCCESS);
+  ASSERT_EQ((int)looping_code, GIF_SUCCESS);
+
+  ASSERT_EQ(once.has_loop_extension, false);
+  ASSERT_EQ(gif_timeline_frame_at(&once, 150), 1U);
+  ASSERT_EQ(gif_timeline_frame_at(&once, 3150), 2U);
+
+  ASSERT_EQ(looping.has_loop_extension, true);
+  ASSERT_EQ(looping.repeat_count, 0U);
+  ASSERT_EQ(gif_timeline_frame_at(&looping, 3150), 1U);
+
+  /* Cleanup */
+  gif_timeline_free(&once, &free);
+  gif_timeline_free(&looping, &free);
+}
+
+static gif_result_code parse_with_limits(gif_limits limits)
+{
+  gif_details details;
+  gif_parse_options options = {.limits = limits};
+  gif_parse_result parse_result = gif_parse_with_options(
+      verify_gif, sizeof(verify_gif), &details, &realloc, &options);
+  gif_free_details(&details, &free);
+  return parse_result.code;
+}
+
+UTEST(limits, abort_early)
+{
+  /* Arrange */
+  gif_limits canvas = {.max_canvas_pixels = 8};
+  gif_limits frames = {.max_frames = 2};
+  gif_limits decoded = {.max_total_decoded_bytes = 3 * 9 * 4 - 1};
+  gif_limits memory = {.max_memory = 16};
+  gif_limits frame_output = {.max_frame_output = 8};
+  gif_limits generous = {
+      .max_canvas_pixels = 9,
+      .max_frames = 3,
+      .max_total_decoded_bytes = 3 * 9 * 4,
+      .max_frame_output = 9,
+  };
+
+  /* Act */
+  gif_result_code canvas_code = parse_with_limits(canvas);
+  gif_result_code frames_code = parse_with_limits(frames);
+  gif_result_code decoded_code = parse_with_limits(decoded);
+  gif_result_code memory_code = parse_with_limits(memory);
+  gif_result_code frame_output_code = parse_with_limits(frame_output);
+  gif_result_code generous_code = parse_with_limits(generous);
+
+  /* Assert */
+  ASSERT_EQ((int)canvas_code, GIF_CANVAS_LIMIT_EXCEEDED);
+  ASSERT_EQ((int)frames_code, GIF_FRAME_LIMIT_EXCEEDED);
+  ASSERT_EQ((int)decoded_code, GIF_DECODED_SIZE_LIMIT_EXCEEDED);
+  ASSERT_EQ((int)memory_code, GIF_MEMORY_LIMIT_EXCEEDED);
+  ASSERT_EQ((int)frame_output_code, GIF_FRAME_OUTPUT_LIMIT_EXCEEDED);
+  ASSERT_EQ((int)generous_code, GIF_SUCCESS);
+}
+
+UTEST(decode, frame_into_padded_target)
+{
+  /* Arrange */
+  gif_details details;
+  gif_parse_result parse_result =
+      gif_parse(verify_gif, sizeof(verify_gif), &details, &realloc);
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+
+  enum { stride = 3 * 4 + 4 };
+  uint8_t pixels[3 * stride];
+  memset(pixels, 0xAB, sizeof(pixels));
+  gif_decode_target target = {
+      .pixels = pixels,
+      .stride = stride,
+      .format = GIF_PIXEL_FORMAT_BGRA8888,
+      .region = GIF_TARGET_FRAME,
+  };
+
+  /* Act */
+  gif_result_code code = gif_decode_frame(&details, 0, &target);
+  gif_result_code out_of_range_code = gif_decode_frame(&details, 3, &target);
+  target.stride = 3 * 4 - 1;
+  gif_result_code invalid_target_code = gif_decode_frame(&details, 0, &target);
+  gif_free_details(&details, &free);
+
+  /* Assert */
+  ASSERT_EQ((int)code, GIF_SUCCESS);
+  ASSERT_EQ((int)out_of_range_code, GIF_FRAME_INDEX_OUT_OF_RANGE);
+  ASSERT_EQ((int)invalid_target_code, GIF_INVALID_DECODE_TARGET);
+
+  /* Indices 0, 1, 1 / 0, 2, 3 / 3, 2, 0 with red, blue, black and white */
+  static const uint8_t expected_rows[3][12] = {
+      {0, 0, 255, 255, 255, 0, 0, 255, 255, 0, 0, 255},
+      {0, 0, 255, 255, 0, 0, 0, 255, 255, 255, 255, 255},
+      {255, 255, 255, 255, 0, 0, 0, 255, 0, 0, 255, 255},
+  };
+  for (size_t y = 0; y < 3; ++y) {
+    const uint8_t* const row = &pixels[y * stride];
+    ASSERT_EQ(memcmp(row, expected_rows[y], sizeof(expected_rows[y])), 0);
+    for (size_t i = 12; i < stride; ++i) {
+      ASSERT_EQ(row[i], 0xAB);
+    }
+  }
+}
+
+/* Runs the tasks back to front on the calling thread, which is a valid order
+ * for a parallel executor to pick */
+static void reverse_executor_run(void* executor_context,
+                                 gif_task task,
+                                 void* task_context,
+                                 size_t count)
+{
+  (void)executor_context;
+  while (count != 0) {
+    --count;
+    task(task_context, count);
+  }
+}
+
+UTEST(decode, frame_in_parallel_bands)
+{
+  /* Arrange */
+  gif_details details;
+  gif_parse_result parse_result =
+      gif_parse(verify_gif, sizeof(verify_gif), &details, &realloc);
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+
+  uint8_t serial[3 * 3 * 4];
+  uint8_t parallel[3 * 3 * 4];
+  memset(serial, 0, sizeof(serial));
+  memset(parallel, 0, sizeof(parallel));
+  gif_decode_target target = {
+      .pixels = serial,
+      .stride = 3 * 4,
+      .format = GIF_PIXEL_FORMAT_RGBA8888,
+      .region = GIF_TARGET_CANVAS,
+  };
+  gif_executor executor = {
+      .run = &reverse_executor_run,
+      .context = NULL,
+      .worker_count = 3,
+  };
+
+  /* Act */
+  gif_result_code serial_code = gif_decode_frame(&details, 0, &target);
+  target.pixels = parallel;
+  gif_result_code parallel_code = gif_decode_frame_parallel(
+      &details, 0, &target, &executor, &realloc, &free);
+  gif_result_code overflow_code = gif_decode_frame_parallel(
+      &details, 2, &target, &executor, &realloc, &free);
+  gif_free_details(&details, &free);
+
+  /* Assert */
+  ASSERT_EQ((int)serial_code, GIF_SUCCESS);
+  ASSERT_EQ((int)parallel_code, GIF_SUCCESS);
+  ASSERT_EQ((int)overflow_code, GIF_LZW_OUTPUT_OVERFLOW);
+  ASSERT_EQ(memcmp(serial, parallel, sizeof(serial)), 0);
+}
+
+/* A 2x2 GIF with a full frame of red, blue, black and white, followed by
+ * three identical 1x2 frames on the right column, which draw a black pixel
+ * above a transparent one. The first of these is disposed to background. */
+static const uint8_t animation_gif[] = {
+    0x47, 0x49, 0x46, 0x38, 0x39, 0x61, 0x02, 0x00, 0x02, 0x00, 0x81, 0x00,
+    0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00, 0xFF, 0xFF,
+    0xFF, 0x21, 0xF9, 0x04, 0x04, 0x0A, 0x00, 0x00, 0x00, 0x2C, 0x00, 0x00,
+    0x00, 0x00, 0x02, 0x00, 0x02, 0x00, 0x00, 0x02, 0x03, 0x44, 0x34, 0x05,
+    0x00, 0x21, 0xF9, 0x04, 0x09, 0x0A, 0x00, 0x03, 0x00, 0x2C, 0x01, 0x00,
+    0x00, 0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x02, 0x02, 0xD4, 0x0A, 0x00,
+    0x21, 0xF9, 0x04, 0x05, 0x0A, 0x00, 0x03, 0x00, 0x2C, 0x01, 0x00, 0x00,
+    0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x02, 0x02, 0xD4, 0x0A, 0x00, 0x21,
+    0xF9, 0x04, 0x05, 0x0A, 0x00, 0x03, 0x00, 0x2C, 0x01, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x02, 0x00, 0x00, 0x02, 0x02, 0xD4, 0x0A, 0x00, 0x3B,
+};
+
+#define RGBA_RED 255, 0, 0, 255
+#define RGBA_BLUE 0, 0, 255, 255
+#define RGBA_BLACK 0, 0, 0, 255
+#define RGBA_WHITE 255, 255, 255, 255
+#define RGBA_CLEAR 0, 0, 0, 0
+
+static const uint8_t animation_canvases[4][16] = {
+    {RGBA_RED, RGBA_BLUE, RGBA_BLACK, RGBA_WHITE},
+    {RGBA_RED, RGBA_BLACK, RGBA_BLACK, RGBA_WHITE},
+    {RGBA_RED, RGBA_BLACK, RGBA_BLACK, RGBA_CLEAR},
+    {RGBA_RED, RGBA_BLACK, RGBA_BLACK, RGBA_CLEAR},
+};
+
+UTEST(decode, composes_animation)
+{
+  /* Arrange */
+  gif_details details;
+  gif_parse_result parse_result =
+      gif_parse(animation_gif, sizeof(animation_gif), &details, &realloc);
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+
+  /* Act */
+  gif_decode_result decode_result = gif_decode(&details, &realloc);
+  gif_free_details(&details, &free);
+
+  /* Assert */
+  ASSERT_EQ((int)decode_result.code, GIF_SUCCESS);
+  ASSERT_NE(decode_result.data, NULL);
+
+  int comparison = memcmp(
+      decode_result.data, animation_canvases, sizeof(animation_canvases));
+
+  /* Cleanup */
+  free(decode_result.data);
+
+  ASSERT_EQ(comparison, 0);
+}
+
+UTEST(decode, spills_to_file)
+{
+  /* Arrange */
+  gif_details details;
+  gif_parse_result parse_result =
+      gif_parse(animation_gif, sizeof(animation_gif), &details, &realloc);
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+
+  gif_decode_options options = {
+      .spill_threshold = 1,
+      .spill_directory = NULL,
+  };
+
+  /* Act */
+  gif_frame_store spilled;
+  gif_result_code spilled_code =
+      gif_decode_to_store(&details, &realloc, &options, &spilled);
+
+  options.spill_threshold = sizeof(animation_canvases);
+  gif_frame_store in_memory;
+  gif_result_code in_memory_code =
+      gif_decode_to_store(&details, &realloc, &options, &in_memory);
+  gif_free_details(&details, &free);
+
+  /* Assert */
+  ASSERT_EQ((int)spilled_code, GIF_SUCCESS);
+  ASSERT_EQ((int)in_memory_code, GIF_SUCCESS);
+  ASSERT_TRUE(spilled.spilled);
+  ASSERT_FALSE(in_memory.spilled);
+  ASSERT_EQ(spilled.size, 4U);
+  ASSERT_EQ(spilled.canvas_size, sizeof(animation_canvases[0]));
+
+  int spilled_comparison = memcmp(
+      spilled.canvases, animation_canvases, sizeof(animation_canvases));
+  int in_memory_comparison = memcmp(
+      in_memory.canvases, animation_canvases, sizeof(animation_canvases));
+
+  /* Cleanup */
+  gif_frame_store_free(&spilled, &free);
+  gif_frame_store_free(&in_memory, &free);
+
+  ASSERT_EQ(spilled_comparison, 0);
+  ASSERT_EQ(in_memory_comparison, 0);
+}
+
+static void count_ready_frame(void* context,
+                              size_t frame_index,
+                              const uint8_t* canvas)
+{
+  size_t* const ready_count = context;
+  if (frame_index == *ready_count && canvas != NULL) {
+    ++*ready_count;
+  }
+}
+
+UTEST(decode, pipelined_animation)
+{
+  /* Arrange */
+  gif_details details;
+  gif_parse_result parse_result =
+      gif_parse(animation_gif, sizeof(animation_gif), &details, &realloc);
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+
+  gif_details broken_details;
+  parse_result =
+      gif_parse(verify_gif, sizeof(verify_gif), &broken_details, &realloc);
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+
+  gif_executor executor = {
+      .run = &reverse_executor_run,
+      .context = NULL,
+      .worker_count = 2,
+  };
+  size_t ready_count = 0;
+  gif_decode_options options = {
+      .executor = &executor,
+      .frame_ready = &count_ready_frame,
+      .frame_ready_context = &ready_count,
+  };
+
+  /* Act */
+  gif_frame_store store;
+  gif_result_code code =
+      gif_decode_to_store(&details, &realloc, &options, &store);
+  gif_free_details(&details, &free);
+
+  options.frame_ready = NULL;
+  gif_frame_store broken_store;
+  gif_result_code broken_code = gif_decode_to_store(
+      &broken_details, &realloc, &options, &broken_store);
+  gif_frame_store_free(&broken_store, &free);
+  gif_free_details(&broken_details, &free);
+
+  /* Assert */
+  ASSERT_EQ((int)code, GIF_SUCCESS);
+  ASSERT_EQ((int)broken_code, GIF_LZW_EARLY_END);
+  ASSERT_EQ(ready_count, 4U);
+
+  int comparison = memcmp(
+      store.canvases, animation_canvases, sizeof(animation_canvases));
+
+  /* Cleanup */
+  gif_frame_store_free(&store, &free);
+
+  ASSERT_EQ(comparison, 0);
+}
+
+UTEST(index, round_trip)
+{
+  /* Arrange */
+  gif_details details;
+  gif_parse_result parse_result =
+      gif_parse(animation_gif, sizeof(animation_gif), &details, &realloc);
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+
+  size_t index_size = gif_index_size(&details);
+  uint8_t* index = malloc(index_size);
+  ASSERT_NE(index, NULL);
+
+  /* Act */
+  gif_result_code small_code = gif_index_write(&details, index, 1);
+  gif_result_code write_code = gif_index_write(&details, index, index_size);
+
+  gif_details loaded;
+  gif_result_code load_code = gif_index_load(index,
+                                             index_size,
+                                             animation_gif,
+                                             sizeof(animation_gif),
+                                             &loaded,
+                                             &realloc);
+  gif_decode_result decode_result = gif_decode(&loaded, &realloc);
+
+  gif_details mismatched;
+  gif_result_code mismatch_code = gif_index_load(index,
+                                                 index_size,
+                                                 animation_gif,
+                                                 sizeof(animation_gif) - 1,
+                                                 &mismatched,
+                                                 &realloc);
+  gif_free_details(&mismatched, &free);
+
+  index[0] = 0;
+  gif_details invalid;
+  gif_result_code invalid_code = gif_index_load(index,
+                                                index_size,
+                                                animation_gif,
+                                                sizeof(animation_gif),
+                                                &invalid,
+                                                &realloc);
+  gif_free_details(&invalid, &free);
+
+  /* Assert */
+  ASSERT_EQ((int)small_code, GIF_INDEX_BUFFER_TOO_SMALL);
+  ASSERT_EQ((int)write_code, GIF_SUCCESS);
+  ASSERT_EQ((int)load_code, GIF_SUCCESS);
+  ASSERT_EQ((int)mismatch_code, GIF_INDEX_DATA_MISMATCH);
+  ASSERT_EQ((int)invalid_code, GIF_INDEX_INVALID);
+
+  ASSERT_EQ(loaded.frame_vector.size, details.frame_vector.size);
+  ASSERT_EQ(loaded.repeat_count, details.repeat_count);
+  ASSERT_EQ(loaded.has_loop_extension, details.has_loop_extension);
+  ASSERT_EQ(memcmp(loaded.global_color_table,
+                   details.global_color_table,
+                   4 * sizeof(uint32_t)),
+            0);
+  for (size_t i = 0; i < details.frame_vector.size; ++i) {
+    const gif_frame_data* const parsed = &details.frame_vector.frames[i];
+    const gif_frame_data* const frame = &loaded.frame_vector.frames[i];
+    ASSERT_EQ(frame->first_subblock, parsed->first_subblock);
+    ASSERT_EQ(frame->data_length, parsed->data_length);
+    ASSERT_EQ(frame->fingerprint, parsed->fingerprint);
+    ASSERT_EQ(frame->graphic_extension.delay, parsed->graphic_extension.delay);
+    ASSERT_EQ((int)frame->graphic_extension.packed.disposal_method,
+              (int)parsed->graphic_extension.packed.disposal_method);
+  }
+
+  ASSERT_EQ((int)decode_result.code, GIF_SUCCESS);
+  int comparison = memcmp(
+      decode_result.data, animation_canvases, sizeof(animation_canvases));
+
+  /* Cleanup */
+  free(decode_result.data);
+  gif_free_details(&loaded, &free);
+  gif_free_details(&details, &free);
+  free(index);
+
+  ASSERT_EQ(comparison, 0);
+}
+
+UTEST(frame_table, dense_arrays)
+{
+  /* Arrange */
+  gif_details details;
+  gif_parse_result parse_result =
+      gif_parse(animation_gif, sizeof(animation_gif), &details, &realloc);
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+
+  /* Act */
+  gif_frame_table table;
+  gif_result_code code = gif_frame_table_build(&details, &table, &realloc);
+
+  /* Assert */
+  ASSERT_EQ((int)code, GIF_SUCCESS);
+  ASSERT_EQ(table.size, 4U);
+
+  for (size_t i = 0; i < table.size; ++i) {
+    const gif_frame_data* const frame = &details.frame_vector.frames[i];
+    ASSERT_EQ(animation_gif + table.data_offsets[i], frame->first_subblock);
+    ASSERT_EQ(table.data_lengths[i], frame->data_length);
+    ASSERT_EQ(table.rects[i].left, frame->descriptor.left);
+    ASSERT_EQ(table.rects[i].width, frame->descriptor.width);
+    ASSERT_EQ(table.rects[i].height, frame->descriptor.height);
+    ASSERT_EQ(table.delays[i], 10);
+    ASSERT_EQ(table.cold[i].fingerprint, frame->fingerprint);
+    ASSERT_EQ(table.cold[i].transparent_color_flag,
+              frame->graphic_extension.packed.transparent_color_flag);
+  }
+
+  ASSERT_EQ(table.disposal_methods[0], GIF_DISPOSAL_NOTHING);
+  ASSERT_EQ(table.disposal_methods[1], GIF_DISPOSAL_BACKGROUND);
+
+  /* Cleanup */
+  gif_frame_table_free(&table, &free);
+  gif_free_details(&details, &free);
+}
+
+UTEST(stress, presets_round_trip)
+{
+  gif_stress_buffer buffer = {0};
+  for (size_t i = 0; i < gif_stress_preset_count; ++i) {
+    /* Arrange */
+    gif_stress_options options = gif_stress_presets[i].options;
+    if (options.frame_count > 64) {
+      options.frame_count = 64;
+    }
+    ASSERT_TRUE(gif_stress_generate(&buffer, &options));
+
+    /* Act */
+    gif_details details;
+    gif_parse_result parse_result =
+        gif_parse(buffer.data, buffer.size, &details, &realloc);
+    ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+
+    gif_frame_verify_result* results =
+        malloc(details.frame_vector.size * sizeof(*results));
+    ASSERT_NE(results, NULL);
+    gif_result_code verify_code = gif_verify(&details, results);
+
+    gif_decode_result decode_result = {GIF_SUCCESS, NULL};
+    size_t canvas_pixels = (size_t)options.canvas_width * options.canvas_height;
+    if (canvas_pixels <= 512U * 512U) {
+      decode_result = gif_decode(&details, &realloc);
+    }
+
+    /* Assert */
+    ASSERT_EQ(details.frame_vector.size, options.frame_count);
+    ASSERT_EQ((int)verify_code, GIF_SUCCESS);
+    for (size_t j = 0; j < options.frame_count; ++j) {
+      size_t height = options.varying_heights
+          ? 1U + j % options.frame_height
+          : options.frame_height;
+      ASSERT_EQ((int)results[j].code, GIF_SUCCESS);
+      ASSERT_EQ(results[j].pixel_count, options.frame_width * height);
+    }
+    ASSERT_EQ((int)decode_result.code, GIF_SUCCESS);
+
+    /* Cleanup */
+    free(decode_result.data);
+    free(results);
+    gif_free_details(&details, &free);
+  }
+
+  gif_stress_buffer_free(&buffer);
+}
+
+UTEST(simd, levels_agree)
+{
+  /* Arrange */
+  gif_stress_options options = gif_stress_presets[0].options;
+  options.canvas_width = 61;
+  options.canvas_height = 37;
+  options.frame_width = 61;
+  options.frame_height = 37;
+  options.frame_count = 16;
+  options.varying_heights = true;
+  options.local_color_tables = true;
+
+  gif_stress_buffer buffer = {0};
+  ASSERT_TRUE(gif_stress_generate(&buffer, &options));
+
+  gif_simd_level supported = gif_simd_level_supported();
+  ASSERT_EQ(gif_simd_level_active(), supported);
+
+  /* Act */
+  gif_decode_result results[GIF_SIMD_LEVEL_AVX512 + 1] = {0};
+  for (int level = 0; level <= (int)supported; ++level) {
+    ASSERT_EQ((int)gif_simd_level_force((gif_simd_level)level), GIF_SUCCESS);
+    ASSERT_EQ((int)gif_simd_level_active(), level);
+
+    gif_details details;
+    gif_parse_result parse_result =
+        gif_parse(buffer.data, buffer.size, &details, &realloc);
+    ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+
+    results[level] = gif_decode(&details, &realloc);
+    gif_free_details(&details, &free);
+  }
+
+  gif_result_code restore_code = gif_simd_level_force(supported);
+  gif_result_code above_code = GIF_SIMD_LEVEL_UNSUPPORTED;
+  if (supported < GIF_SIMD_LEVEL_AVX512) {
+    above_code = gif_simd_level_force((gif_simd_level)(supported + 1));
+  }
+
+  /* Assert */
+  ASSERT_EQ((int)restore_code, GIF_SUCCESS);
+  ASSERT_EQ((int)above_code, GIF_SIMD_LEVEL_UNSUPPORTED);
+
+  size_t size = (size_t)61 * 37 * 4 * options.frame_count;
+  for (int level = 0; level <= (int)supported; ++level) {
+    ASSERT_EQ((int)results[level].code, GIF_SUCCESS);
+    ASSERT_EQ(memcmp(results[level].data, results[0].data, size), 0);
+  }
+
+  /* Cleanup */
+  for (int level = 0; level <= (int)supported; ++level) {
+    free(results[level].data);
+  }
+  gif_stress_buffer_free(&buffer);
+}
+
+UTEST(parse, stops_after_poster_frame)
+{
+  /* Arrange */
+  gif_stress_options options = gif_stress_presets[0].options;
+  options.canvas_width = 32;
+  options.canvas_height = 32;
+  options.frame_width = 32;
+  options.frame_height = 32;
+  options.frame_count = 8;
+  options.local_color_tables = true;
+
+  gif_stress_buffer buffer = {0};
+  ASSERT_TRUE(gif_stress_generate(&buffer, &options));
+
+  gif_details full_details;
+  gif_parse_result full_result =
+      gif_parse(buffer.data, buffer.size, &full_details, &realloc);
+  ASSERT_EQ((int)full_result.code, GIF_SUCCESS);
+  ASSERT_FALSE(full_details.is_partial);
+
+  gif_parse_options parse_options = {.stop_after_frames = 1};
+
+  /* Act */
+  gif_details details;
+  gif_parse_result parse_result = gif_parse_with_options(
+      buffer.data, buffer.size, &details, &realloc, &parse_options);
+  gif_decode_result decode_result = gif_decode(&details, &realloc);
+  gif_decode_result full_decode_result = gif_decode(&full_details, &realloc);
+
+  /* Assert */
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+  ASSERT_TRUE(details.is_partial);
+  ASSERT_EQ(details.frame_vector.size, 1U);
+  ASSERT_EQ(details.frame_vector.frames[0].data_length,
+            full_details.frame_vector.frames[0].data_length);
+
+  /* The 7 frames that were not parsed are left over */
+  size_t leftover_bytes;
+  memcpy(&leftover_bytes, &parse_result.data, sizeof(leftover_bytes));
+  ASSERT_GT(leftover_bytes, buffer.size / 2U);
+
+  ASSERT_EQ((int)decode_result.code, GIF_SUCCESS);
+  ASSERT_EQ((int)full_decode_result.code, GIF_SUCCESS);
+  int comparison =
+      memcmp(decode_result.data, full_decode_result.data, 32U * 32U * 4U);
+
+  /* Cleanup */
+  free(decode_result.data);
+  free(full_decode_result.data);
+  gif_free_details(&details, &free);
+  gif_free_details(&full_details, &free);
+  gif_stress_buffer_free(&buffer);
+
+  ASSERT_EQ(comparison, 0);
+}
+
+/**
+ * Computes the statistics of a frame the slow way, from its pixels decoded
+ * into a target the size of the frame.
+ */
+UTEST(decode, tiled_store)
+{
+  /* Arrange */
+  gif_stress_options options = gif_stress_presets[0].options;
+  options.canvas_width = 40;
+  options.canvas_height = 30;
+  options.frame_width = 17;
+  options.frame_height = 13;
+  options.frame_count = 12;
+  options.varying_heights = false;
+
+  gif_stress_buffer buffer = {0};
+  ASSERT_TRUE(gif_stress_generate(&buffer, &options));
+
+  gif_details details;
+  gif_parse_result parse_result =
+      gif_parse(buffer.data, buffer.size, &details, &realloc);
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+  gif_decode_result expected = gif_decode(&details, &realloc);
+  ASSERT_EQ((int)expected.code, GIF_SUCCESS);
+
+  const size_t tile_size = 8;
+  const size_t columns = 5;
+  const size_t rows = 4;
+  const size_t bitmap_size = (columns * rows + 7) / 8;
+  size_t dirty_size = gif_dirty_tiles_size(&details, (uint16_t)tile_size);
+  uint8_t* dirty_tiles = malloc(dirty_size);
+  ASSERT_NE(dirty_tiles, NULL);
+
+  gif_decode_options decode_options = {0};
+  decode_options.tile_size = (uint16_t)tile_size;
+  decode_options.dirty_tiles = dirty_tiles;
+
+  /* Act */
+  gif_frame_store store;
+  gif_result_code code =
+      gif_decode_to_store(&details, &realloc, &decode_options, &store);
+
+  /* Assert */
+  ASSERT_EQ((int)code, GIF_SUCCESS);
+  ASSERT_EQ(dirty_size, bitmap_size * 12U);
+  ASSERT_EQ(store.canvas_size, columns * rows * tile_size * tile_size * 4U);
+
+  const uint8_t* const canvases = expected.data;
+  const size_t canvas_bytes = 40U * 30U * 4U;
+  size_t clean_tiles = 0;
+  for (size_t i = 0; i < store.size; ++i) {
+    const uint8_t* const tiled = &store.canvases[i * store.canvas_size];
+    const uint8_t* const canvas = &canvases[i * canvas_bytes];
+    for (size_t tile = 0; tile < columns * rows; ++tile) {
+      uint8_t bits = dirty_tiles[i * bitmap_size + tile / 8];
+      bool is_dirty = (bits & (1U << tile % 8)) != 0;
+      bool is_changed = false;
+      for (size_t y = 0; y < tile_size; ++y) {
+        for (size_t x = 0; x < tile_size; ++x) {
+          size_t canvas_x = tile % columns * tile_size + x;
+          size_t canvas_y = tile / columns * tile_size + y;
+          const uint8_t* pixel =
+              &tiled[(tile * tile_size * tile_size + y * tile_size + x) * 4];
+          uint8_t before[4] = {0};
+          if (canvas_x >= 40 || canvas_y >= 30) {
+            ASSERT_EQ(memcmp(pixel, before, 4), 0);
+            continue;
+          }
+
+          size_t offset = (canvas_y * 40 + canvas_x) * 4;
+          ASSERT_EQ(memcmp(pixel, &canvas[offset], 4), 0);
+          if (i != 0) {
+            memcpy(before, &canvas[offset - canvas_bytes], 4);
+          }
+          is_changed |= memcmp(before, &canvas[offset], 4) != 0;
+        }
+      }
+
+      ASSERT_TRUE(is_dirty || !is_changed);
+      clean_tiles += is_dirty ? 0U : 1U;
+    }
+  }
+  ASSERT_GT(clean_tiles, 0U);
+
+  /* Cleanup */
+  gif_frame_store_free(&store, &free);
+  free(dirty_tiles);
+  free(expected.data);
+  gif_free_details(&details, &free);
+  gif_stress_buffer_free(&buffer);
+}
+
+static gif_result_code decode_indexed_stress(
+    const gif_stress_options* options,
+    gif_indexed_frames* frames)
+{
+  gif_stress_buffer buffer = {0};
+  if (!gif_stress_generate(&buffer, options)) {
+    return GIF_ALLOC_FAIL;
+  }
+
+  gif_details details;
+  gif_result_code code =
+      gif_parse(buffer.data, buffer.size, &details, &realloc).code;
+  if (code == GIF_SUCCESS) {
+    code = gif_decode_indexed(&details, &realloc, frames);
+  }
+
+  gif_free_details(&details, &free);
+  gif_stress_buffer_free(&buffer);
+  return code;
+}
+
+UTEST(decode, indexed_storage)
+{
+  /* Arrange */
+  gif_stress_options options = gif_stress_presets[0].options;
+  options.canvas_width = 40;
+  options.canvas_height = 30;
+  options.frame_width = 17;
+  options.frame_height = 13;
+  options.frame_count = 12;
+  options.reserve_transparent_index = true;
+
+  gif_stress_buffer buffer = {0};
+  ASSERT_TRUE(gif_stress_generate(&buffer, &options));
+
+  gif_details details;
+  gif_parse_result parse_result =
+      gif_parse(buffer.data, buffer.size, &details, &realloc);
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+  gif_decode_result expected = gif_decode(&details, &realloc);
+  ASSERT_EQ((int)expected.code, GIF_SUCCESS);
+
+  const size_t canvas_bytes = 40U * 30U * 4U;
+  uint8_t* canvas = malloc(canvas_bytes);
+  ASSERT_NE(canvas, NULL);
+
+  /* Act */
+  gif_indexed_frames frames;
+  gif_result_code code = gif_decode_indexed(&details, &realloc, &frames);
+
+  gif_stress_options local_options = options;
+  local_options.local_color_tables = true;
+  gif_indexed_frames local_frames;
+  gif_result_code local_code =
+      decode_indexed_stress(&local_options, &local_frames);
+
+  gif_stress_options clashing_options = options;
+  clashing_options.reserve_transparent_index = false;
+  gif_indexed_frames clashing_frames;
+  gif_result_code clashing_code =
+      decode_indexed_stress(&clashing_options, &clashing_frames);
+
+  /* Assert */
+  ASSERT_EQ((int)code, GIF_SUCCESS);
+  ASSERT_EQ(frames.size, 12U);
+  ASSERT_EQ(frames.canvas_size, 40U * 30U);
+  ASSERT_EQ(frames.transparent_index, 0);
+  ASSERT_EQ((int)local_code, GIF_INDEXED_UNSUPPORTED);
+  ASSERT_EQ((int)clashing_code, GIF_INDEXED_UNSUPPORTED);
+
+  const gif_decode_target target = {
+      .pixels = canvas,
+      .stride = 40U * 4U,
+      .format = GIF_PIXEL_FORMAT_RGBA8888,
+      .region = GIF_TARGET_CANVAS,
+  };
+  const uint8_t* const canvases = expected.data;
+  for (size_t i = 0; i < frames.size; ++i) {
+    ASSERT_EQ((int)gif_indexed_frame_expand(&frames, i, &target), GIF_SUCCESS);
+    ASSERT_EQ(memcmp(canvas, &canvases[i * canvas_bytes], canvas_bytes), 0);
+  }
+
+  /* Cleanup */
+  gif_indexed_frames_free(&clashing_frames, &free);
+  gif_indexed_frames_free(&local_frames, &free);
+  gif_indexed_frames_free(&frames, &free);
+  free(canvas);
+  free(expected.data);
+  gif_free_details(&details, &free);
+  gif_stress_buffer_free(&buffer);
+}
+
+static gif_frame_analytics reference_analytics(const gif_details* details,
+                                               size_t index)
+{
+  const gif_frame_descriptor* descriptor =
+      &details->frame_vector.frames[index].descriptor;
+  size_t width = descriptor->width;
+  size_t height = descriptor->height;
+  uint8_t* pixels = malloc(width * height * 4U);
+  gif_decode_target target = {
+      .pixels = pixels,
+      .stride = width * 4U,
+      .format = GIF_PIXEL_FORMAT_RGBA8888,
+      .region = GIF_TARGET_FRAME,
+  };
+  gif_frame_analytics result = {0};
+  if (pixels == NULL
+      || gif_decode_frame(details, index, &target) != GIF_SUCCESS)
+  {
+    free(pixels);
+    return result;
+  }
+
+  size_t left = SIZE_MAX, top = SIZE_MAX, right = 0, bottom = 0;
+  uint64_t channels[3] = {0}, opaque = 0;
+  uint64_t sums[64] = {0}, counts[64] = {0};
+  for (size_t y = 0; y < height; ++y) {
+    for (size_t x = 0; x < width; ++x) {
+      const uint8_t* pixel = &pixels[(y * width + x) * 4U];
+      size_t cell = y * 8U / height * 8U + x * 8U / width;
+      sums[cell] += (77U * pixel[0] + 150U * pixel[1] + 29U * pixel[2]) >> 8U;
+      ++counts[cell];
+      if (pixel[3] == 0) {
+        result.has_transparency = true;
+        continue;
+      }
+
+      left = x < left ? x : left;
+      top = y < top ? y : top;
+      right = x > right ? x : right;
+      bottom = y > bottom ? y : bottom;
+      for (size_t i = 0; i < 3U; ++i) {
+        channels[i] += pixel[i];
+      }
+      ++opaque;
+    }
+  }
+  free(pixels);
+
+  if (opaque != 0) {
+    result.average_color = (uint32_t)(channels[0] / opaque) << 16U
+        | (uint32_t)(channels[1] / opaque) << 8U
+        | (uint32_t)(channels[2] / opaque);
+    result.opaque_bounds = (gif_frame_rect) {
+        (uint16_t)(descriptor->left + left),
+        (uint16_t)(descriptor->top + top),
+        (uint16_t)(right - left + 1U),
+        (uint16_t)(bottom - top + 1U),
+    };
+  }
+
+  uint64_t means[64], total = 0;
+  for (size_t i = 0; i < 64U; ++i) {
+    means[i] = counts[i] == 0 ? 0 : sums[i] / counts[i];
+    total += means[i];
+  }
+  for (size_t i = 0; i < 64U; ++i) {
+    result.average_hash |= (uint64_t)(means[i] > total / 64U) << i;
+  }
+
+  return result;
+}
+
+UTEST(decode, fused_analytics)
+{
+  /* Arrange */
+  gif_stress_options options = gif_stress_presets[0].options;
+  options.canvas_width = 40;
+  options.canvas_height = 30;
+  options.frame_width = 29;
+  options.frame_height = 21;
+  options.frame_count = 6;
+  options.varying_heights = true;
+
+  gif_stress_buffer buffer = {0};
+  ASSERT_TRUE(gif_stress_generate(&buffer, &options));
+
+  gif_details details;
+  gif_parse_result parse_result =
+      gif_parse(buffer.data, buffer.size, &details, &realloc);
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+
+  gif_executor executor = {
+      .run = &reverse_executor_run,
+      .context = NULL,
+      .worker_count = 2,
+  };
+  gif_frame_analytics serial[6];
+  gif_frame_analytics pipelined[6];
+  gif_decode_options serial_options = {.analytics = serial};
+  gif_decode_options pipelined_options = {
+      .executor = &executor,
+      .analytics = pipelined,
+  };
+
+  /* Act */
+  gif_frame_store serial_store = {0};
+  gif_result_code serial_code =
+      gif_decode_to_store(&details, &realloc, &serial_options, &serial_store);
+  gif_frame_store pipelined_store = {0};
+  gif_result_code pipelined_code = gif_decode_to_store(
+      &details, &realloc, &pipelined_options, &pipelined_store);
+
+  /* Assert */
+  ASSERT_EQ((int)serial_code, GIF_SUCCESS);
+  ASSERT_EQ((int)pipelined_code, GIF_SUCCESS);
+  for (size_t i = 0; i < 6U; ++i) {
+    gif_frame_analytics expected = reference_analytics(&details, i);
+    const gif_frame_descriptor* descriptor =
+        &details.frame_vector.frames[i].descriptor;
+    uint64_t histogram_total = 0;
+    for (size_t j = 0; j < 256U; ++j) {
+      histogram_total += serial[i].index_histogram[j];
+    }
+
+    uint64_t pixel_count = (uint64_t)descriptor->width * descriptor->height;
+    ASSERT_EQ(histogram_total, pixel_count);
+    ASSERT_EQ(serial[i].has_transparency, expected.has_transparency);
+    ASSERT_EQ(serial[i].average_color, expected.average_color);
+    ASSERT_EQ(serial[i].average_hash, expected.average_hash);
+    ASSERT_EQ(memcmp(&serial[i].opaque_bounds,
+                     &expected.opaque_bounds,
+                     sizeof(gif_frame_rect)),
+              0);
+    ASSERT_EQ(memcmp(&serial[i], &pipelined[i], sizeof(serial[i])), 0);
+  }
+
+  /* Cleanup */
+  gif_frame_store_free(&serial_store, &free);
+  gif_frame_store_free(&pipelined_store, &free);
+  gif_free_details(&details, &free);
+  gif_stress_buffer_free(&buffer);
+}
+
+typedef struct memory_source {
+  const uint8_t* data;
+  size_t read_count;
+  size_t largest_read;
+  bool fail;
+} memory_source;
+
+static bool read_memory_source(void* context,
+                               uint64_t offset,
+                               void* buffer,
+                               size_t size)
+{
+  memory_source* const source = context;
+  if (source->fail) {
+    return false;
+  }
+
+  ++source->read_count;
+  if (size > source->largest_read) {
+    source->largest_read = size;
+  }
+  memcpy(buffer, source->data + offset, size);
+  return true;
+}
+
+UTEST(parse, from_read_callback)
+{
+  /* Arrange */
+  gif_stress_options options = gif_stress_presets[0].options;
+  options.canvas_width = 96;
+  options.canvas_height = 96;
+  options.frame_width = 96;
+  options.frame_height = 96;
+  options.frame_count = 8;
+  options.local_color_tables = true;
+  options.subblock_size = 17;
+
+  gif_stress_buffer buffer = {0};
+  ASSERT_TRUE(gif_stress_generate(&buffer, &options));
+
+  gif_details expected;
+  gif_parse_result expected_parse =
+      gif_parse(buffer.data, buffer.size, &expected, &realloc);
+  ASSERT_EQ((int)expected_parse.code, GIF_SUCCESS);
+  gif_decode_result expected_decode = gif_decode(&expected, &realloc);
+  ASSERT_EQ((int)expected_decode.code, GIF_SUCCESS);
+
+  memory_source memory = {buffer.data, 0, 0, false};
+  const gif_source source = {&read_memory_source, &memory, buffer.size};
+
+  /* Act */
+  gif_details details;
+  gif_parse_result parse_result =
+      gif_parse_source(&source, &details, &realloc, NULL);
+  size_t parse_reads = memory.read_count;
+  gif_decode_result decode_result = gif_decode(&details, &realloc);
+
+  memory.fail = true;
+  gif_decode_result failed_decode = gif_decode(&details, &realloc);
+
+  /* Assert */
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+  ASSERT_GT(parse_reads, 1U);
+  ASSERT_LE(memory.largest_read, 16384U);
+  ASSERT_EQ(details.raw_data, NULL);
+  ASSERT_EQ(details.frame_vector.size, expected.frame_vector.size);
+  for (size_t i = 0; i < details.frame_vector.size; ++i) {
+    const gif_frame_data* const frame = &details.frame_vector.frames[i];
+    const gif_frame_data* const parsed = &expected.frame_vector.frames[i];
+    ASSERT_EQ(frame->first_subblock, NULL);
+    ASSERT_EQ(frame->data_offset, parsed->data_offset);
+    ASSERT_EQ(buffer.data + frame->data_offset, parsed->first_subblock);
+    ASSERT_EQ(frame->data_length, parsed->data_length);
+    ASSERT_EQ(frame->fingerprint, parsed->fingerprint);
+  }
+
+  ASSERT_EQ((int)decode_result.code, GIF_SUCCESS);
+  ASSERT_EQ((int)failed_decode.code, GIF_SOURCE_READ_FAIL);
+  int comparison = memcmp(
+      decode_result.data, expected_decode.data, 96U * 96U * 4U * 8U);
+
+  /* Cleanup */
+  free(failed_decode.data);
+  free(decode_result.data);
+  free(expected_decode.data);
+  gif_free_details(&details, &free);
+  gif_free_details(&expected, &free);
+  gif_stress_buffer_free(&buffer);
+
+  ASSERT_EQ(comparison, 0);
+}
+
+static size_t counted_allocations;
+
+static void* counting_realloc(void* allocation, size_t size)
+{
+  ++counted_allocations;
+  return realloc(allocation, size);
+}
+
+UTEST(context, steady_state_does_not_allocate)
+{
+  /* Arrange */
+  gif_stress_options options = gif_stress_presets[0].options;
+  options.canvas_width = 24;
+  options.canvas_height = 24;
+  options.frame_width = 24;
+  options.frame_height = 24;
+  options.frame_count = 12;
+  options.local_color_tables = true;
+
+  gif_stress_buffer large = {0};
+  ASSERT_TRUE(gif_stress_generate(&large, &options));
+
+  options.frame_count = 5;
+  options.seed = 7;
+  gif_stress_buffer small = {0};
+  ASSERT_TRUE(gif_stress_generate(&small, &options));
+
+  gif_details details;
+  gif_parse_result parse_result =
+      gif_parse(small.data, small.size, &details, &realloc);
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+  gif_decode_result expected = gif_decode(&details, &realloc);
+  gif_free_details(&details, &free);
+  ASSERT_EQ((int)expected.code, GIF_SUCCESS);
+
+  gif_context context;
+  gif_context_init(&context, &counting_realloc, &free);
+
+  /* Act */
+  /* The color tables of the first file overflow the empty pool, which only
+   * grows when the second file is parsed */
+  counted_allocations = 0;
+  gif_context_parse(&context, large.data, large.size, NULL);
+  gif_context_decode(&context);
+  gif_parse_result warm_parse =
+      gif_context_parse(&context, large.data, large.size, NULL);
+  gif_decode_result warm_decode = gif_context_decode(&context);
+  size_t warm_allocations = counted_allocations;
+
+  counted_allocations = 0;
+  gif_parse_result parse_code =
+      gif_context_parse(&context, small.data, small.size, NULL);
+  gif_decode_result decode_result = gif_context_decode(&context);
+  size_t steady_allocations = counted_allocations;
+
+  /* Assert */
+  ASSERT_EQ((int)warm_parse.code, GIF_SUCCESS);
+  ASSERT_EQ((int)warm_decode.code, GIF_SUCCESS);
+  ASSERT_GT(warm_allocations, 0U);
+
+  ASSERT_EQ((int)parse_code.code, GIF_SUCCESS);
+  ASSERT_EQ((int)decode_result.code, GIF_SUCCESS);
+  ASSERT_EQ(steady_allocations, 0U);
+  ASSERT_EQ(context.details.frame_vector.size, 5U);
+  int comparison =
+      memcmp(decode_result.data, expected.data, 24U * 24U * 4U * 5U);
+
+  /* Cleanup */
+  gif_context_free(&context);
+  free(expected.data);
+  gif_stress_buffer_free(&large);
+  gif_stress_buffer_free(&small);
+
+  ASSERT_EQ(comparison, 0);
+}
+
+static size_t counted_deallocations;
+
+static void counting_free(void* allocation)
+{
+  ++counted_deallocations;
+  free(allocation);
+}
+
+UTEST(parse, parallel_scan_matches_sequential)
+{
+  /* Arrange */
+  gif_stress_options options = gif_stress_presets[0].options;
+  options.canvas_width = 256;
+  options.canvas_height = 256;
+  options.frame_width = 256;
+  options.frame_height = 256;
+  options.frame_count = 24;
+  options.local_color_tables = true;
+  options.subblock_size = 200;
+
+  gif_stress_buffer buffer = {0};
+  ASSERT_TRUE(gif_stress_generate(&buffer, &options));
+  ASSERT_GE(buffer.size, 1024U * 1024U);
+
+  gif_details expected;
+  gif_parse_result expected_parse =
+      gif_parse(buffer.data, buffer.size, &expected, &realloc);
+  ASSERT_EQ((int)expected_parse.code, GIF_SUCCESS);
+
+  /* Cut inside the image data of the last frame */
+  const size_t truncated_size = buffer.size - 100U;
+  gif_details truncated_expected;
+  gif_parse_result truncated_expected_parse = gif_parse(
+      buffer.data, truncated_size, &truncated_expected, &realloc);
+
+  const gif_executor executor = {&reverse_executor_run, NULL, 2};
+  gif_parse_options parse_options = {
+      .executor = &executor,
+      .deallocator = &counting_free,
+  };
+
+  /* Act */
+  counted_deallocations = 0;
+  gif_details details;
+  gif_parse_result parse_result = gif_parse_with_options(
+      buffer.data, buffer.size, &details, &realloc, &parse_options);
+  size_t scratch_deallocations = counted_deallocations;
+
+  gif_details truncated;
+  gif_parse_result truncated_parse = gif_parse_with_options(
+      buffer.data, truncated_size, &truncated, &realloc, &parse_options);
+
+  /* Assert */
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+  ASSERT_GT(scratch_deallocations, 0U);
+  ASSERT_EQ(memcmp(&parse_result.data, &expected_parse.data, sizeof(void*)),
+            0);
+  ASSERT_EQ(details.frame_vector.size, expected.frame_vector.size);
+  for (size_t i = 0; i < details.frame_vector.size; ++i) {
+    const gif_frame_data* const frame = &details.frame_vector.frames[i];
+    const gif_frame_data* const parsed = &expected.frame_vector.frames[i];
+    ASSERT_EQ(frame->first_subblock, parsed->first_subblock);
+    ASSERT_EQ(frame->data_length, parsed->data_length);
+    ASSERT_EQ(frame->fingerprint, parsed->fingerprint);
+    ASSERT_EQ(frame->min_code_size, parsed->min_code_size);
+  }
+
+  ASSERT_NE((int)truncated_expected_parse.code, GIF_SUCCESS);
+  ASSERT_EQ((int)truncated_parse.code, (int)truncated_expected_parse.code);
+  ASSERT_EQ(truncated_parse.last_position,
+            truncated_expected_parse.last_position);
+
+  /* Cleanup */
+  gif_free_details(&truncated, &free);
+  gif_free_details(&truncated_expected, &free);
+  gif_free_details(&details, &free);
+  gif_free_details(&expected, &free);
+  gif_stress_buffer_free(&buffer);
+}
+
+UTEST(parse, parallel_scan_respects_memory_limit)
+{
+  /* Arrange */
+  gif_stress_options options = gif_stress_presets[0].options;
+  options.canvas_width = 256;
+  options.canvas_height = 256;
+  options.frame_width = 256;
+  options.frame_height = 256;
+  options.frame_count = 24;
+  options.local_color_tables = true;
+  options.subblock_size = 200;
+
+  gif_stress_buffer buffer = {0};
+  ASSERT_TRUE(gif_stress_generate(&buffer, &options));
+
+  /* Enough for the frames and their color tables, but not for the scan */
+  const gif_limits limits = {.max_memory = 128U * 1024U};
+  const gif_executor executor = {&reverse_executor_run, NULL, 2};
+  gif_parse_options sequential_options = {.limits = limits};
+  gif_parse_options parallel_options = {
+      .limits = limits,
+      .executor = &executor,
+      .deallocator = &counting_free,
+  };
+
+  /* Act */
+  gif_details sequential;
+  gif_parse_result sequential_parse = gif_parse_with_options(
+      buffer.data, buffer.size, &sequential, &realloc, &sequential_options);
+
+  counted_deallocations = 0;
+  gif_details parallel;
+  gif_parse_result parallel_parse = gif_parse_with_options(
+      buffer.data, buffer.size, &parallel, &realloc, &parallel_options);
+  size_t scratch_deallocations = counted_deallocations;
+
+  /* Assert */
+  ASSERT_EQ((int)sequential_parse.code, GIF_SUCCESS);
+  ASSERT_EQ((int)parallel_parse.code, GIF_MEMORY_LIMIT_EXCEEDED);
+  ASSERT_EQ(scratch_deallocations, 0U);
+
+  /* Cleanup */
+  gif_free_details(&sequential, &free);
+  gif_free_details(&parallel, &free);
+  gif_stress_buffer_free(&buffer);
+}
+
+/* A 1x1 GIF87a with an XMP application extension and an extension with a
+ * label unknown to GIF89a before its only frame */
+static const uint8_t gif87a_extensions_gif[] = {
+    0x47, 0x49, 0x46, 0x38, 0x37, 0x61, 0x01, 0x00, 0x01, 0x00, 0x80, 0x00,
+    0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x21, 0xFF, 0x0B, 0x58, 0x4D,
+    0x50, 0x20, 0x44, 0x61, 0x74, 0x61, 0x58, 0x4D, 0x50, 0x03, 0x61, 0x62,
+    0x63, 0x02, 0x64, 0x65, 0x00, 0x21, 0x02, 0x01, 0x78, 0x00, 0x2C, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x02, 0x02, 0x44, 0x01,
+    0x00, 0x3B,
+};
+
+UTEST(parse, gif87a_and_foreign_extensions)
+{
+  /* Arrange */
+  gif_parse_options options = {.keep_application_extensions = true};
+
+  /* Act */
+  gif_details skipped;
+  gif_parse_result skipped_result = gif_parse(gif87a_extensions_gif,
+                                              sizeof(gif87a_extensions_gif),
+                                              &skipped,
+                                              &realloc);
+
+  gif_details details;
+  gif_parse_result parse_result =
+      gif_parse_with_options(gif87a_extensions_gif,
+                             sizeof(gif87a_extensions_gif),
+                             &details,
+                             &realloc,
+                             &options);
+  gif_decode_result decode_result = gif_decode(&details, &realloc);
+
+  /* Assert */
+  ASSERT_EQ((int)skipped_result.code, GIF_SUCCESS);
+  ASSERT_EQ(skipped.application_extensions.size, 0U);
+  ASSERT_EQ(skipped.frame_vector.size, 1U);
+
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+  ASSERT_EQ(details.application_extensions.size, 1U);
+  const gif_application_extension* const extension =
+      &details.application_extensions.extensions[0];
+  ASSERT_EQ(memcmp(extension->identifier, "XMP DataXMP", 11), 0);
+  ASSERT_EQ(extension->frame_index, 0U);
+  ASSERT_EQ(extension->offset, 33U);
+  ASSERT_EQ(extension->subblocks, &gif87a_extensions_gif[33]);
+  ASSERT_EQ(extension->size, 8U);
+
+  ASSERT_EQ((int)decode_result.code, GIF_SUCCESS);
+  const uint8_t red[4] = {0xFF, 0x00, 0x00, 0xFF};
+  ASSERT_EQ(memcmp(decode_result.data, red, sizeof(red)), 0);
+
+  /* Cleanup */
+  free(decode_result.data);
+  gif_free_details(&details, &free);
+  gif_free_details(&skipped, &free);
+}
+
+/* A 1x1 GIF with a red and a blue frame, whose image data is the same length
+ * and only differs in the pixel index */
+static const uint8_t red_blue_gif[] = {
+    0x47, 0x49, 0x46, 0x38, 0x39, 0x61, 0x01, 0x00, 0x01, 0x00, 0x80, 0x00,
+    0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x2C, 0x00, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x01, 0x00, 0x00, 0x02, 0x02, 0x44, 0x01, 0x00, 0x2C, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x02, 0x02, 0x4C, 0x01,
+    0x00, 0x3B,
+};
+
+UTEST(decode, colliding_fingerprints_are_not_reused)
+{
+  /* Arrange */
+  gif_details details;
+  gif_parse_result parse_result =
+      gif_parse(red_blue_gif, sizeof(red_blue_gif), &details, &realloc);
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+  ASSERT_EQ(details.frame_vector.size, 2U);
+
+  /* Stands in for a frame crafted to collide with the one before it */
+  gif_frame_data* const frames = details.frame_vector.frames;
+  frames[1].fingerprint = frames[0].fingerprint;
+
+  gif_executor executor = {&reverse_executor_run, NULL, 2};
+  uint8_t dirty_tiles[2];
+  ASSERT_EQ(gif_dirty_tiles_size(&details, 1), sizeof(dirty_tiles));
+  gif_decode_options options = {
+      .executor = &executor,
+      .tile_size = 1,
+      .dirty_tiles = dirty_tiles,
+  };
+
+  /* Act */
+  gif_decode_result decode_result = gif_decode(&details, &realloc);
+
+  gif_frame_store store;
+  gif_result_code store_code =
+      gif_decode_to_store(&details, &realloc, &options, &store);
+
+  gif_indexed_frames indexed;
+  gif_result_code indexed_code =
+      gif_decode_indexed(&details, &realloc, &indexed);
+
+  /* Assert */
+  const uint8_t expected[2][4] = {
+      {0xFF, 0x00, 0x00, 0xFF},
+      {0x00, 0x00, 0xFF, 0xFF},
+  };
+
+  ASSERT_EQ((int)decode_result.code, GIF_SUCCESS);
+  ASSERT_EQ(memcmp(decode_result.data, expected, sizeof(expected)), 0);
+
+  ASSERT_EQ((int)store_code, GIF_SUCCESS);
+  ASSERT_EQ(memcmp(store.canvases, expected, sizeof(expected)), 0);
+  ASSERT_EQ(dirty_tiles[1], 1U);
+
+  ASSERT_EQ((int)indexed_code, GIF_SUCCESS);
+  ASSERT_EQ(indexed.indices[0], 0U);
+  ASSERT_EQ(indexed.indices[1], 1U);
+
+  /* Cleanup */
+  gif_indexed_frames_free(&indexed, &free);
+  gif_frame_store_free(&store, &free);
+  free(decode_result.data);
+  gif_free_details(&details, &free);
+}
+
+UTEST(index, tampered_fingerprints)
+{
+  /* Arrange */
+  gif_details details;
+  gif_parse_result parse_result =
+      gif_parse(red_blue_gif, sizeof(red_blue_gif), &details, &realloc);
+  ASSERT_EQ((int)parse_result.code, GIF_SUCCESS);
+
+  size_t index_size = gif_index_size(&details);
+  uint8_t* index = malloc(index_size);
+  ASSERT_NE(index, NULL);
+  ASSERT_EQ((int)gif_index_write(&details, index, index_size), GIF_SUCCESS);
+
+  /* Overwrite the fingerprint of the blue frame with that of the red one.
+   * It follows the 48 byte header, the 48 byte record of the red frame and
+   * the offset and length of the blue one, and is stored little-endian. */
+  const uint64_t red = details.frame_vector.frames[0].fingerprint;
+  const size_t fingerprint_offset = 48U + 48U + 16U;
+  ASSERT_GE(index_size, fingerprint_offset + 8U);
+  for (size_t i = 0; i < 8U; ++i) {
+    index[fingerprint_offset + i] = (uint8_t)(red >> (i * 8U));
+  }
+
+  /* Act */
+  gif_details loaded;
+  gif_result_code load_code = gif_index_load(index,
+                                             index_size,
+                                             red_blue_gif,
+                                             sizeof(red_blue_gif),
+                                             &loaded,
+                                             &realloc);
+  gif_decode_result decode_result = gif_decode(&loaded, &realloc);
+
+  /* Assert */
+  ASSERT_EQ((int)load_code, GIF_SUCCESS);
+  ASSERT_EQ(loaded.frame_vector.frames[1].fingerprint, red);
+  ASSERT_EQ((int)decode_result.code, GIF_SUCCESS);
+  const uint8_t* const canvases = decode_result.data;
+  const uint8_t blue_pixel[4] = {0x00, 0x00, 0xFF, 0xFF};
+  ASSERT_EQ(memcmp(&canvases[4], blue_pixel, sizeof(blue_pixel)), 0);
+
+  /* Cleanup */
+  free(decode_result.data);
+  gif_free_details(&loaded, &free);
+  gif_free_details(&details, &free);
+  free(index);
+}
+
 UTEST_MAIN()
@@ -0,0 +1,431 @@
+#include "gif_stress.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+const gif_stress_preset gif_stress_presets[] = {
+    {
+        "max_canvas",
+        {
+            .canvas_width = 0xFFFF,
+            .canvas_height = 0xFFFF,
+            .frame_width = 1024,
+            .frame_height = 1024,
+            .frame_count = 1,
+            .subblock_size = 255,
+            .seed = 1,
+        },
+    },
+    {
+        "tiny_frames",
+        {
+            .canvas_width = 64,
+            .canvas_height = 64,
+            .frame_width = 1,
+            .frame_height = 1,
+            .frame_count = 5000,
+            .subblock_size = 255,
+            .seed = 2,
+        },
+    },
+    {
+        "local_tables",
+        {
+            .canvas_width = 64,
+            .canvas_height = 64,
+            .frame_width = 64,
+            .frame_height = 64,
+            .frame_count = 256,
+            .local_color_tables = true,
+            .subblock_size = 255,
+            .seed = 3,
+        },
+    },
+    {
+        "table_resets",
+        {
+            .canvas_width = 512,
+            .canvas_height = 512,
+            .frame_width = 512,
+            .frame_height = 512,
+            .frame_count = 1,
+            .subblock_size = 255,
+            .clear_interval = 1,
+            .seed = 4,
+        },
+    },
+    {
+        "tiny_subblocks",
+        {
+            .canvas_width = 512,
+            .canvas_height = 512,
+            .frame_width = 512,
+            .frame_height = 512,
+            .frame_count = 1,
+            .subblock_size = 1,
+            .seed = 5,
+        },
+    },
+    {
+        "interlaced",
+        {
+            .canvas_width = 64,
+            .canvas_height = 64,
+            .frame_width = 64,
+            .frame_height = 64,
+            .frame_count = 64,
+            .varying_heights = true,
+            .interlaced = true,
+            .subblock_size = 255,
+            .seed = 6,
+        },
+    },
+};
+
+const size_t gif_stress_preset_count =
+    sizeof(gif_stress_presets) / sizeof(gif_stress_presets[0]);
+
+/* ---- Output buffer ---- */
+
+typedef struct writer {
+  gif_stress_buffer* buffer;
+  bool failed;
+} writer;
+
+static void write_bytes(writer* const out,
+                        const void* const bytes,
+                        const size_t size)
+{
+  gif_stress_buffer* const buffer = out->buffer;
+  if (out->failed) {
+    return;
+  }
+
+  if (buffer->capacity - buffer->size < size) {
+    size_t capacity = buffer->capacity == 0 ? 4096 : buffer->capacity;
+    while (capacity - buffer->size < size) {
+      capacity *= 2;
+    }
+
+    uint8_t* const data = realloc(buffer->data, capacity);
+    if (data == NULL) {
+      out->failed = true;
+      return;
+    }
+
+    buffer->data = data;
+    buffer->capacity = capacity;
+  }
+
+  memcpy(&buffer->data[buffer->size], bytes, size);
+  buffer->size += size;
+}
+
+static void write_byte(writer* const out, const uint8_t byte)
+{
+  write_bytes(out, &byte, 1);
+}
+
+static void write_short(writer* const out, const uint16_t value)
+{
+  const uint8_t bytes[] = {(uint8_t)value, (uint8_t)(value >> 8U)};
+  write_bytes(out, bytes, sizeof(bytes));
+}
+
+/* ---- Deterministic content ---- */
+
+static uint32_t next_random(uint32_t* const state)
+{
+  uint32_t x = *state;
+  x ^= x << 13U;
+  x ^= x >> 17U;
+  x ^= x << 5U;
+  *state = x;
+  return x;
+}
+
+static void write_color_table(writer* const out, uint32_t* const random)
+{
+  for (size_t i = 0; i < 256; ++i) {
+    const uint32_t color = next_random(random);
+    const uint8_t rgb[] = {
+        (uint8_t)color, (uint8_t)(color >> 8U), (uint8_t)(color >> 16U)};
+    write_bytes(out, rgb, sizeof(rgb));
+  }
+}
+
+/* ---- LZW encoder ---- */
+
+#define LZW_MIN_CODE_SIZE 8U
+#define LZW_MAX_CODES 4096U
+#define LZW_HASH_SIZE 8192U
+
+typedef struct lzw_encoder {
+  writer* out;
+  uint8_t subblock_size;
+  uint8_t subblock[255];
+  uint8_t subblock_used;
+
+  uint32_t bits;
+  uint8_t bit_count;
+  uint8_t width;
+  uint16_t next_code;
+
+  /* Entries are valid only if their generation matches, which makes clearing
+   * the table O(1) even when it happens after every code */
+  uint32_t generation;
+  uint32_t generations[LZW_HASH_SIZE];
+  uint32_t keys[LZW_HASH_SIZE];
+  uint16_t codes[LZW_HASH_SIZE];
+} lzw_encoder;
+
+static void flush_subblock(lzw_encoder* const encoder)
+{
+  if (encoder->subblock_used == 0) {
+    return;
+  }
+
+  write_byte(encoder->out, encoder->subblock_used);
+  write_bytes(encoder->out, encoder->subblock, encoder->subblock_used);
+  encoder->subblock_used = 0;
+}
+
+static void emit_byte(lzw_encoder* const encoder, const uint8_t byte)
+{
+  encoder->subblock[encoder->subblock_used++] = byte;
+  if (encoder->subblock_used == encoder->subblock_size) {
+    flush_subblock(encoder);
+  }
+}
+
+static void emit_code(lzw_encoder* const encoder, const uint16_t code)
+{
+  encoder->bits |= (uint32_t)code << encoder->bit_count;
+  encoder->bit_count = (uint8_t)(encoder->bit_count + encoder->width);
+  while (encoder->bit_count >= 8U) {
+    emit_byte(encoder, (uint8_t)encoder->bits);
+    encoder->bits >>= 8U;
+    encoder->bit_count = (uint8_t)(encoder->bit_count - 8U);
+  }
+}
+
+static void reset_table(lzw_encoder* const encoder)
+{
+  ++encoder->generation;
+  encoder->width = LZW_MIN_CODE_SIZE + 1U;
+  encoder->next_code = (1U << LZW_MIN_CODE_SIZE) + 2U;
+}
+
+static size_t find_slot(const lzw_encoder* const encoder, const uint32_t key)
+{
+  size_t slot = (key * 2654435761U) & (LZW_HASH_SIZE - 1U);
+  while (encoder->generations[slot] == encoder->generation
+         && encoder->keys[slot] != key)
+  {
+    slot = (slot + 1U) & (LZW_HASH_SIZE - 1U);
+  }
+
+  return slot;
+}
+
+/**
+ * Encodes \c count indices, widening codes one code later than the table grows
+ * to match the deferred width changes of GIF decoders.
+ */
+static void encode(lzw_encoder* const encoder,
+                   const gif_stress_options* const options,
+                   const uint8_t* const indices,
+                   const size_t count)
+{
+  encoder->subblock_size = options->subblock_size;
+  encoder->subblock_used = 0;
+  encoder->bits = 0;
+  encoder->bit_count = 0;
+
+  const uint16_t clear_code = 1U << LZW_MIN_CODE_SIZE;
+  reset_table(encoder);
+  emit_code(encoder, clear_code);
+
+  size_t codes_since_clear = 0;
+  uint16_t prefix = indices[0];
+  for (size_t i = 1; i < count; ++i) {
+    const uint8_t index = indices[i];
+    const uint32_t key = (uint32_t)prefix << 8U | index;
+    const size_t slot = find_slot(encoder, key);
+    if (encoder->generations[slot] == encoder->generation) {
+      prefix = encoder->codes[slot];
+      continue;
+    }
+
+    emit_code(encoder, prefix);
+    prefix = index;
+    if (options->clear_interval != 0
+        && ++codes_since_clear == options->clear_interval)
+    {
+      emit_code(encoder, clear_code);
+      reset_table(encoder);
+      codes_since_clear = 0;
+      continue;
+    }
+
+    if (encoder->next_code < LZW_MAX_CODES) {
+      encoder->generations[slot] = encoder->generation;
+      encoder->keys[slot] = key;
+      encoder->codes[slot] = encoder->next_code++;
+      if (encoder->next_code > (1U << encoder->width) && encoder->width < 12U) {
+        ++encoder->width;
+      }
+    }
+  }
+
+  emit_code(encoder, prefix);
+  emit_code(encoder, (uint16_t)(clear_code + 1U));
+  if (encoder->bit_count != 0) {
+    emit_byte(encoder, (uint8_t)encoder->bits);
+  }
+
+  flush_subblock(encoder);
+  write_byte(encoder->out, 0);
+}
+
+/* ---- Frames ---- */
+
+/**
+ * Order in which the rows of an interlaced frame are stored.
+ */
+static size_t interlaced_source_row(size_t row, const size_t height)
+{
+  static const size_t starts[] = {0, 4, 2, 1};
+  static const size_t steps[] = {8, 8, 4, 2};
+  for (size_t pass = 0; pass < 4; ++pass) {
+    const size_t start = starts[pass];
+    const size_t pass_rows =
+        height > start ? (height - start + steps[pass] - 1U) / steps[pass] : 0;
+    if (row < pass_rows) {
+      return start + row * steps[pass];
+    }
+    row -= pass_rows;
+  }
+
+  return row;
+}
+
+/**
+ * Fills the frame with gradients broken up by noise, which keeps the LZW
+ * strings short enough to exercise every code width.
+ */
+static void fill_indices(uint8_t* const indices,
+                         const size_t width,
+                         const size_t height,
+                         const bool interlaced,
+                         const uint8_t lowest_index,
+                         uint32_t* const random)
+{
+  for (size_t row = 0; row < height; ++row) {
+    const size_t y = interlaced ? interlaced_source_row(row, height) : row;
+    for (size_t x = 0; x < width; ++x) {
+      const uint32_t noise = next_random(random) & 3U;
+      const uint8_t index = (uint8_t)(x / 7U + y / 5U + noise);
+      indices[row * width + x] = index < lowest_index ? lowest_index : index;
+    }
+  }
+}
+
+static void write_frame(writer* const out,
+                        lzw_encoder* const encoder,
+                        const gif_stress_options* const options,
+                        const size_t frame_index,
+                        uint8_t* const indices,
+                        uint32_t* const random)
+{
+  const uint16_t width = options->frame_width;
+  uint16_t height = options->frame_height;
+  if (options->varying_heights) {
+    height = (uint16_t)(1U + frame_index % options->frame_height);
+  }
+
+  /* Graphic control extension, cycling through the disposal methods */
+  const uint8_t disposal = (uint8_t)(frame_index % 4U);
+  const uint8_t transparency = (uint8_t)(frame_index % 2U);
+  const uint8_t extension[] = {
+      0x21, 0xF9, 4, (uint8_t)(disposal << 2U | transparency)};
+  write_bytes(out, extension, sizeof(extension));
+  write_short(out, 0);
+  write_byte(out, 0);
+  write_byte(out, 0);
+
+  const uint32_t left_range = (uint32_t)(options->canvas_width - width) + 1U;
+  const uint32_t top_range = (uint32_t)(options->canvas_height - height) + 1U;
+  write_byte(out, 0x2C);
+  write_short(out, (uint16_t)(next_random(random) % left_range));
+  write_short(out, (uint16_t)(next_random(random) % top_range));
+  write_short(out, width);
+  write_short(out, height);
+  write_byte(out,
+             (uint8_t)((options->local_color_tables ? 0x87U : 0U)
+                       | (options->interlaced ? 0x40U : 0U)));
+  if (options->local_color_tables) {
+    write_color_table(out, random);
+  }
+
+  write_byte(out, LZW_MIN_CODE_SIZE);
+  const size_t count = (size_t)width * height;
+  const uint8_t lowest_index =
+      options->reserve_transparent_index && transparency == 0 ? 1U : 0U;
+  fill_indices(
+      indices, width, height, options->interlaced, lowest_index, random);
+  encode(encoder, options, indices, count);
+}
+
+static const uint8_t header[] = {'G', 'I', 'F', '8', '9', 'a'};
+
+static const uint8_t netscape_extension[] = {
+    0x21, 0xFF, 11, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E',
+    '2',  '.',  '0', 3,  1,   0,   0,   0};
+
+bool gif_stress_generate(gif_stress_buffer* const buffer,
+                         const gif_stress_options* const options)
+{
+  buffer->size = 0;
+  writer out = {
+      .buffer = buffer,
+      .failed = false,
+  };
+
+  const size_t max_pixels =
+      (size_t)options->frame_width * options->frame_height;
+  uint8_t* const indices = malloc(max_pixels);
+  lzw_encoder* const encoder = calloc(1, sizeof(*encoder));
+  if (indices == NULL || encoder == NULL) {
+    free(indices);
+    free(encoder);
+    return false;
+  }
+
+  encoder->out = &out;
+
+  uint32_t random = options->seed == 0 ? 1U : options->seed;
+  write_bytes(&out, header, sizeof(header));
+  write_short(&out, options->canvas_width);
+  write_short(&out, options->canvas_height);
+  write_byte(&out, 0xF7);
+  write_byte(&out, 0);
+  write_byte(&out, 0);
+  write_color_table(&out, &random);
+  write_bytes(&out, netscape_extension, sizeof(netscape_extension));
+
+  for (size_t i = 0; i < options->frame_count; ++i) {
+    write_frame(&out, encoder, options, i, indices, &random);
+  }
+
+  write_byte(&out, 0x3B);
+  free(encoder);
+  free(indices);
+  return !out.failed;
+}
+
+void gif_stress_buffer_free(gif_stress_buffer* const buffer)
+{
+  free(buffer->data);
+  *buffer = (gif_stress_buffer) {0};
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct gif_stress_buffer {
+  uint8_t* data;
+  size_t size;
+  size_t capacity;
+} gif_stress_buffer;
+
+/**
+ * Shape of a generated GIF. Every frame uses 256 color indices, so the LZW
+ * minimum code size is always 8.
+ */
+typedef struct gif_stress_options {
+  uint16_t canvas_width;
+  uint16_t canvas_height;
+
+  uint16_t frame_width;
+  uint16_t frame_height;
+  size_t frame_count;
+
+  /** Gives frame \c i a height of <tt>1 + i % frame_height</tt>. */
+  bool varying_heights;
+
+  bool local_color_tables;
+  bool interlaced;
+
+  /**
+   * Keeps frames without transparency from drawing index 0, the transparent
+   * index of the rest, as in files made for a single palette.
+   */
+  bool reserve_transparent_index;
+
+  /** Size of every sub-block but the last one of a frame, 1 to 255. */
+  uint8_t subblock_size;
+
+  /**
+   * Number of codes after which a clear code is emitted. With 0 only the
+   * leading clear code is emitted and the table fills up and stays full.
+   */
+  size_t clear_interval;
+
+  uint32_t seed;
+} gif_stress_options;
+
+typedef struct gif_stress_preset {
+  const char* name;
+  gif_stress_options options;
+} gif_stress_preset;
+
+/**
+ * The pathological shapes the generator knows about: maximum-size canvases,
+ * thousands of tiny frames, a local color table per frame, constant LZW table
+ * resets, 1 byte sub-blocks and interlaced frames of every height remainder.
+ */
+extern const gif_stress_preset gif_stress_presets[];
+extern const size_t gif_stress_preset_count;
+
+/**
+ * Deterministically writes a GIF described by \c options to \c buffer, which
+ * must be zero initialized or hold the result of a previous call. The same
+ * options always produce the same bytes.
+ *
+ * @return \c false if memory could not be allocated
+ */
+bool gif_stress_generate(gif_stress_buffer* buffer,
+                         const gif_stress_options* options);
+
+void gif_stress_buffer_free(gif_stress_buffer* buffer);
@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "gif_stress.h"
+
+/**
+ * Writes every preset as <directory>/<name>.gif, or only the presets named
+ * after the directory.
+ */
+int main(int argc, char* argv[])
+{
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <directory> [preset...]\n", argv[0]);
+    return 2;
+  }
+
+  int result = 0;
+  gif_stress_buffer buffer = {0};
+  for (size_t i = 0; i < gif_stress_preset_count; ++i) {
+    const gif_stress_preset* const preset = &gif_stress_presets[i];
+    int selected = argc == 2;
+    for (int j = 2; j < argc; ++j) {
+      selected |= strcmp(argv[j], preset->name) == 0;
+    }
+
+    if (!selected) {
+      continue;
+    }
+
+    char path[4096];
+    if (snprintf(path, sizeof(path), "%s/%s.gif", argv[1], preset->name)
+        >= (int)sizeof(path))
+    {
+      fprintf(stderr, "%s: path too long\n", preset->name);
+      result = 1;
+      continue;
+    }
+
+    if (!gif_stress_generate(&buffer, &preset->options)) {
+      fprintf(stderr, "%s: out of memory\n", preset->name);
+      result = 1;
+      continue;
+    }
+
+    FILE* const file = fopen(path, "wb");
+    if (file == NULL) {
+      perror(path);
+      result = 1;
+      continue;
+    }
+
+    const size_t written = fwrite(buffer.data, 1, buffer.size, file);
+    if (fclose(file) != 0 || written != buffer.size) {
+      perror(path);
+      result = 1;
+      continue;
+    }
+
+    printf("%s: %zu bytes\n", path, buffer.size);
+  }
+
+  gif_stress_buffer_free(&buffer);
+  return result;
+}